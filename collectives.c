@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mpi.h>
+// Collective microbenchmark, grown from the MPI_Scatter and MPI_Gather of abg.c.
+// Times MPI_Scatter, MPI_Bcast and MPI_Gather for 1 byte up to MAX_BYTES per process (doubling the size each step)
+// and reports the fastest, average and slowest process of every size as comma separated values.
+// MPI_Scatter and MPI_Gather move BYTES to or from every process; MPI_Bcast sends BYTES to every process.
+
+// Root process.
+const int ROOT_PROCESS = 0;
+// Largest message per process, in bytes, when not given on the command line (16 MB).
+const long DEFAULT_MAX_BYTES = 16L * 1024 * 1024;
+// Bytes moved for every message size, which sets the number of repetitions of the size.
+const long TARGET_BYTES = 256L * 1024 * 1024;
+// Bounds of the number of repetitions of every message size.
+const int MIN_REPETITIONS = 3;
+const int MAX_REPETITIONS = 1000;
+
+// Collectives which are timed.
+enum Collective
+{
+    SCATTER,
+    BCAST,
+    GATHER
+};
+
+// Runs the collective once with bytes per process.
+void runCollective(enum Collective collective, char *all_buffer, char *buffer, int bytes);
+// Times the collective with bytes per process and prints its line on the root process.
+void timeCollective(enum Collective collective, const char *name, char *all_buffer, char *buffer, long bytes, int world_rank, int world_size);
+
+int main(int argc, char **argv)
+{
+    MPI_Init(&argc, &argv);
+
+    int world_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    int world_size;
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    long max_bytes = argc > 1 ? atol(argv[1]) : DEFAULT_MAX_BYTES;
+    if (max_bytes < 1)
+    {
+        fprintf(stderr, "Usage: %s [MAX_BYTES_PER_PROCESS]\n", argv[0]);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // The whole scattered and gathered array is only needed on the root process.
+    char *all_buffer = NULL;
+    if (world_rank == ROOT_PROCESS)
+    {
+        if ((all_buffer = malloc(max_bytes * world_size)) == NULL)
+        {
+            fprintf(stderr, "Buffer of %ld bytes cannot be created!\n", max_bytes * world_size);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        memset(all_buffer, 1, max_bytes * world_size);
+    }
+    char *buffer;
+    if ((buffer = malloc(max_bytes)) == NULL)
+    {
+        fprintf(stderr, "Buffer of %ld bytes cannot be created!\n", max_bytes);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    memset(buffer, 1, max_bytes);
+
+    if (world_rank == ROOT_PROCESS)
+    {
+        printf("benchmark,bytes,processes,repetitions,min_us,avg_us,max_us\n");
+    }
+
+    for (long bytes = 1; bytes <= max_bytes; bytes *= 2)
+    {
+        timeCollective(SCATTER, "scatter", all_buffer, buffer, bytes, world_rank, world_size);
+        timeCollective(BCAST, "bcast", all_buffer, buffer, bytes, world_rank, world_size);
+        timeCollective(GATHER, "gather", all_buffer, buffer, bytes, world_rank, world_size);
+    }
+
+    free(all_buffer);
+    free(buffer);
+    MPI_Finalize();
+}
+
+void runCollective(enum Collective collective, char *all_buffer, char *buffer, int bytes)
+{
+    switch (collective)
+    {
+    case SCATTER:
+        MPI_Scatter(all_buffer, bytes, MPI_CHAR, buffer, bytes, MPI_CHAR, ROOT_PROCESS, MPI_COMM_WORLD);
+        break;
+    case BCAST:
+        MPI_Bcast(buffer, bytes, MPI_CHAR, ROOT_PROCESS, MPI_COMM_WORLD);
+        break;
+    case GATHER:
+        MPI_Gather(buffer, bytes, MPI_CHAR, all_buffer, bytes, MPI_CHAR, ROOT_PROCESS, MPI_COMM_WORLD);
+        break;
+    }
+}
+
+void timeCollective(enum Collective collective, const char *name, char *all_buffer, char *buffer, long bytes, int world_rank, int world_size)
+{
+    long repetitions = TARGET_BYTES / (bytes * world_size);
+    if (repetitions < MIN_REPETITIONS)
+    {
+        repetitions = MIN_REPETITIONS;
+    }
+    if (repetitions > MAX_REPETITIONS)
+    {
+        repetitions = MAX_REPETITIONS;
+    }
+
+    // The first run warms up the connections and is not timed.
+    runCollective(collective, all_buffer, buffer, bytes);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double starting_time = MPI_Wtime();
+    for (long repetition = 0; repetition < repetitions; repetition++)
+    {
+        runCollective(collective, all_buffer, buffer, bytes);
+    }
+    double time = (MPI_Wtime() - starting_time) / repetitions;
+
+    // Every process sees a different time, depending on when it leaves the collective.
+    double min_time, max_time, sum_time;
+    MPI_Reduce(&time, &min_time, 1, MPI_DOUBLE, MPI_MIN, ROOT_PROCESS, MPI_COMM_WORLD);
+    MPI_Reduce(&time, &max_time, 1, MPI_DOUBLE, MPI_MAX, ROOT_PROCESS, MPI_COMM_WORLD);
+    MPI_Reduce(&time, &sum_time, 1, MPI_DOUBLE, MPI_SUM, ROOT_PROCESS, MPI_COMM_WORLD);
+    if (world_rank == ROOT_PROCESS)
+    {
+        printf("%s,%ld,%d,%ld,%.3f,%.3f,%.3f\n", name, bytes, world_size, repetitions,
+               min_time * 1e6, sum_time / world_size * 1e6, max_time * 1e6);
+    }
+}
@@ -3,18 +3,35 @@
 #include <mpi.h>
 #include <time.h>
 #include <limits.h>
+#include <string.h>
+#include "matrix-pack.h"
+#include "matrix-transpose.h"
+#include "matrix-kernels.h"
+#include "matrix-autotune.h"
+#include "matrix-quantized.h"
+#include "matrix-epilogue.h"
+#include "matrix-counters.h"
+#include "matrix-shared.h"
 // We will use the row-major order to store multidimensional arrays in linear storage such as random access memory.
 // This also helps to scatter the elements of the array and process them in more easy way.
 // Reference: https://en.wikipedia.org/wiki/Row-_and_column-major_order
 
 // Root process.
 const int ROOT_PROCESS = 0;
+// Phases in which the hardware counters are collected (--counters).
+enum Phase
+{
+    PHASE_DISTRIBUTE,
+    PHASE_COMPUTE,
+    PHASE_GATHER,
+    PHASES
+};
 // Generates the matrix of provided size.
 void generateMatrix(int *matrix, int rows, int columns);
 // Prints the matrix.
 void printMatrix(int *matrix, int rows, int columns);
-// Multiplies two matrices and prints the product matrix.
-void multiplyMatrix(int *matrix1, int rows1, int columns1, int *matrix2, int rows2, int columns2);
+// Multiplies two matrices, applies the epilogue with the previous product matrix3 and prints the product matrix.
+void multiplyMatrix(int *matrix1, int rows1, int columns1, int *matrix2, int rows2, int columns2, const struct Epilogue *epilogue, const int *matrix3);
 // Prints the dashed lines.
 void printDashedLine(int times);
 // To print the partial received matrix.
@@ -23,7 +40,7 @@ void printPartialMatrix(int *matrix, int size);
 int main(argc, argv) int argc;
 char *argv[];
 {
-    if (argc != 3)
+    if (argc < 3)
     {
         fprintf(stderr, "Usage: please enter the dimension of the matrix(ROWS<space>32<return>)\n");
         exit(1);
@@ -31,6 +48,52 @@ char *argv[];
     const int ROWS = atoi(argv[1]);
     const int COLUMNS = atoi(argv[2]);
 
+    // Declared value range of the input matrices (--range=MIN:MAX); detected from the matrices when not provided.
+    int declared_range = 0, range_min = 0, range_max = 0;
+    // Distributes matrix2 transposed (--transpose-b) so every inner product reads contiguous memory.
+    int transpose_matrix2 = 0;
+    // Calibrates the local kernel (--autotune) and stores the winner in the tuning file for the later runs.
+    int autotune = 0;
+    // Multiplies the 8-bit or 16-bit transfer types with the low-precision kernels (--quantized).
+    int quantized = 0;
+    // Epilogue fused into the kernel: product = function(alpha * matrix1 x matrix2 + beta * matrix3 + biases)
+    // (--alpha=N, --beta=N, --bias=row|column|both, --function=relu|abs|clamp8); matrix3 and the biases are generated.
+    struct Epilogue epilogue = identityEpilogue();
+    int row_bias_enabled = 0, column_bias_enabled = 0;
+    // Collects the hardware counters of every phase (--counters), appending them to a CSV file with --counters=FILE.
+    int collect_counters = 0;
+    const char *counters_file = NULL;
+    for (int arg_index = 3; arg_index < argc; arg_index++)
+    {
+        if (strncmp(argv[arg_index], "--range=", 8) == 0 && parsePackRange(argv[arg_index] + 8, &range_min, &range_max))
+        {
+            declared_range = 1;
+        }
+        else if (strcmp(argv[arg_index], "--transpose-b") == 0)
+        {
+            transpose_matrix2 = 1;
+        }
+        else if (strcmp(argv[arg_index], "--autotune") == 0)
+        {
+            autotune = 1;
+        }
+        else if (strcmp(argv[arg_index], "--quantized") == 0)
+        {
+            quantized = 1;
+        }
+        else if (strcmp(argv[arg_index], "--counters") == 0 || strncmp(argv[arg_index], "--counters=", 11) == 0)
+        {
+            collect_counters = 1;
+            counters_file = argv[arg_index][10] == '=' ? argv[arg_index] + 11 : NULL;
+        }
+        else if (!parseEpilogueOption(argv[arg_index], &epilogue, &row_bias_enabled, &column_bias_enabled))
+        {
+            fprintf(stderr, "Usage: unknown option %s (supported: --range=MIN:MAX, --transpose-b, --autotune, --quantized, "
+                            EPILOGUE_OPTIONS_USAGE ", --counters[=FILE])\n", argv[arg_index]);
+            exit(1);
+        }
+    }
+
     int process_rank, process_size;
 
     if (MPI_Init(&argc, &argv) != MPI_SUCCESS)
@@ -65,14 +128,25 @@ char *argv[];
     int LENGTH_OF_METRIX = ROWS * COLUMNS;
     // Will be allocated memory only by the root process
     int *matrix1;
-
-    // As second matrix must be possessed by every process, memory allocation should be done by every process.
-    int *matrix2;
-    if ((matrix2 = malloc(LENGTH_OF_METRIX * sizeof(int))) == NULL)
-    {
-        printf("Second matrix cannot be created!");
-        exit(1);
-    }
+    // Previous product which the epilogue accumulates into (beta != 0), allocated only by the root process.
+    int *matrix3 = NULL;
+    // Biases of the rows and of the columns of the product, held by every process.
+    int *row_bias = NULL, *column_bias = NULL;
+    // Types of the elements of matrix1 and matrix2 on the wire, selected by the root process.
+    int pack_types[2];
+
+    // Groups the processes which share the memory of a node (matrix-shared.h); the root process always leads its node,
+    // and only the node leaders take part in the broadcast of matrix2 between the nodes.
+    MPI_Comm node_comm, leader_comm;
+    int node_rank = splitNodeComms(MPI_COMM_WORLD, &node_comm, &leader_comm);
+
+    // As second matrix must be possessed by every process, it is allocated once per node by the node leader
+    // and the other processes of the node read it in place.
+    MPI_Win matrix2_window;
+    int *matrix2 = allocateNodeSharedMatrix(LENGTH_OF_METRIX, node_comm, &matrix2_window);
+    // matrix2 as generated, kept by the root process for the check; with --transpose-b the shared matrix holds
+    // its transpose instead.
+    int *original_matrix2 = matrix2;
 
     if (process_rank == ROOT_PROCESS)
     {
@@ -81,11 +155,49 @@ char *argv[];
             printf("First matrix cannot be created!");
             exit(1);
         }
+        if (transpose_matrix2 && (original_matrix2 = malloc(LENGTH_OF_METRIX * sizeof(int))) == NULL)
+        {
+            printf("Second matrix cannot be created!");
+            exit(1);
+        }
         generateMatrix(matrix1, ROWS, COLUMNS);
-        generateMatrix(matrix2, COLUMNS, ROWS);
+        generateMatrix(original_matrix2, COLUMNS, ROWS);
 
         printMatrix(matrix1, ROWS, COLUMNS);
-        printMatrix(matrix2, COLUMNS, ROWS);
+        printMatrix(original_matrix2, COLUMNS, ROWS);
+
+        if (epilogue.beta != 0)
+        {
+            if ((matrix3 = malloc(ROWS * ROWS * sizeof(int))) == NULL)
+            {
+                printf("Accumulated matrix cannot be created!");
+                exit(1);
+            }
+            generateMatrix(matrix3, ROWS, ROWS);
+            printMatrix(matrix3, ROWS, ROWS);
+        }
+
+        // Selects the narrowest type which carries the elements of each matrix over the wire.
+        pack_types[0] = declared_range ? packTypeForRange(range_min, range_max) : detectPackType(matrix1, LENGTH_OF_METRIX);
+        pack_types[1] = declared_range ? packTypeForRange(range_min, range_max) : detectPackType(original_matrix2, LENGTH_OF_METRIX);
+        // A declared range is only trusted as far as the matrices hold to it; a narrower type would truncate them.
+        for (int matrix_index = 0; declared_range && matrix_index < 2; matrix_index++)
+        {
+            int *matrix = matrix_index == 0 ? matrix1 : original_matrix2;
+            if (!packTypeHolds(matrix, LENGTH_OF_METRIX, pack_types[matrix_index]))
+            {
+                fprintf(stderr, "\nmatrix%d has values outside --range=%d:%d, widening its transfer type.\n", matrix_index + 1, range_min, range_max);
+                pack_types[matrix_index] = detectPackType(matrix, LENGTH_OF_METRIX);
+            }
+        }
+        printf("\nTransfer types: %s x %s\n", packTypeName(pack_types[0]), packTypeName(pack_types[1]));
+
+        // Transposes matrix2 once, before it is distributed, straight into the shared matrix, so its columns become
+        // the rows of the shared matrix.
+        if (transpose_matrix2)
+        {
+            transposeMatrix(original_matrix2, COLUMNS, ROWS, matrix2);
+        }
 
         // Notes the starting time.
         starting_time = MPI_Wtime();
@@ -99,10 +211,62 @@ char *argv[];
     // Will store the received elements for matrix1.
     int matrix1_rows[send_count];
 
-    // Scatters the matrix1 elements
-    MPI_Scatter(matrix1, send_count, MPI_INT, matrix1_rows, send_count, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
-    // Broadcasts the matrix2 to the all processes.
-    MPI_Bcast(matrix2, LENGTH_OF_METRIX, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+    // Counters which cannot be opened are left out, so every phase is timed even without them.
+    struct PerfCounters counters;
+    openPerfCounters(&counters, collect_counters);
+    startPerfPhase(&counters);
+
+    MPI_Bcast(pack_types, 2, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+
+    // The biases are ROWS long each, so every process receives them whole.
+    if (row_bias_enabled || column_bias_enabled)
+    {
+        if ((row_bias = calloc(ROWS, sizeof(int))) == NULL || (column_bias = calloc(ROWS, sizeof(int))) == NULL)
+        {
+            printf("Biases cannot be created!");
+            exit(1);
+        }
+        if (process_rank == ROOT_PROCESS)
+        {
+            generateEpilogueBiases(row_bias, column_bias, ROWS, row_bias_enabled, column_bias_enabled);
+        }
+        MPI_Bcast(row_bias, ROWS, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+        MPI_Bcast(column_bias, ROWS, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+        epilogue.row_bias = row_bias_enabled ? row_bias : NULL;
+        epilogue.column_bias = column_bias_enabled ? column_bias : NULL;
+    }
+    enum PackType matrix1_type = pack_types[0], matrix2_type = pack_types[1];
+
+    // Scatters the matrix1 elements in their narrow type and widens them on receipt.
+    void *packed_matrix1 = NULL;
+    if (process_rank == ROOT_PROCESS)
+    {
+        packed_matrix1 = allocatePacked(LENGTH_OF_METRIX, matrix1_type);
+        packMatrix(matrix1, LENGTH_OF_METRIX, matrix1_type, packed_matrix1);
+    }
+    void *packed_matrix1_rows = allocatePacked(send_count, matrix1_type);
+    MPI_Scatter(packed_matrix1, send_count, packDatatype(matrix1_type), packed_matrix1_rows, send_count, packDatatype(matrix1_type), ROOT_PROCESS, MPI_COMM_WORLD);
+    unpackMatrix(packed_matrix1_rows, send_count, matrix1_type, matrix1_rows);
+    free(packed_matrix1_rows);
+    free(packed_matrix1);
+
+    // Broadcasts the matrix2 to the all processes, in its narrow type, and widens it into the shared matrix of each node.
+    if (leader_comm != MPI_COMM_NULL)
+    {
+        void *packed_matrix2 = allocatePacked(LENGTH_OF_METRIX, matrix2_type);
+        if (process_rank == ROOT_PROCESS)
+        {
+            packMatrix(matrix2, LENGTH_OF_METRIX, matrix2_type, packed_matrix2);
+        }
+        MPI_Bcast(packed_matrix2, LENGTH_OF_METRIX, packDatatype(matrix2_type), ROOT_PROCESS, leader_comm);
+        if (process_rank != ROOT_PROCESS)
+        {
+            unpackMatrix(packed_matrix2, LENGTH_OF_METRIX, matrix2_type, matrix2);
+        }
+        free(packed_matrix2);
+    }
+    // Makes the matrix2 written by the node leader visible to the other processes of the node.
+    MPI_Win_fence(0, matrix2_window);
 
     // Columns of matrix 2
     // Resultant product matrix will be the size of this columns of matrix 2.
@@ -126,23 +290,164 @@ char *argv[];
         exit(1);
     }
 
-    // Uses three linear equations to calculate the position of elements in the respective matrix.
-    for (int product_matrix_row_index = 0; product_matrix_row_index < product_matrix_rows; product_matrix_row_index++)
+    // The rows of the product held by the process start at first_product_row; the epilogue accumulates into
+    // the same rows of matrix3, which are scattered into the product before it is computed.
+    int first_product_row = process_rank * product_matrix_rows;
+    int fused_epilogue = !isIdentityEpilogue(&epilogue);
+    if (epilogue.beta != 0)
+    {
+        MPI_Scatter(matrix3, product_matrix_length, MPI_INT, product_matrix, product_matrix_length, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+    }
+    stopPerfPhase(&counters, PHASE_DISTRIBUTE);
+
+    if (fused_epilogue && process_rank == ROOT_PROCESS)
     {
-        for (int row_index = 0; row_index < ROWS; row_index++)
+        printf("\nEpilogue: alpha %d, beta %d, bias %s, function %s\n", epilogue.alpha, epilogue.beta,
+               row_bias_enabled && column_bias_enabled ? "both" : row_bias_enabled ? "row" : column_bias_enabled ? "column" : "none",
+               epilogueFunctionName(epilogue.function));
+    }
+
+    startPerfPhase(&counters);
+    // The 8-bit kernel takes an 8-bit matrix1 and a signed 8-bit matrix2; the 16-bit kernel takes any types which fit int16.
+    int quantized_bits = 0;
+    if (quantized && fused_epilogue)
+    {
+        if (process_rank == ROOT_PROCESS)
+        {
+            fprintf(stderr, "\nThe epilogue is not fused into the quantized kernels, multiplying with the int kernel instead.\n");
+        }
+    }
+    else if (quantized)
+    {
+        if ((matrix1_type == PACK_INT8 || matrix1_type == PACK_UINT8) && matrix2_type == PACK_INT8 && COLUMNS <= QUANTIZED8_MAX_INNER)
+        {
+            quantized_bits = 8;
+        }
+        else if (matrix1_type != PACK_UINT16 && matrix1_type != PACK_INT32 && matrix2_type != PACK_UINT16 && matrix2_type != PACK_INT32)
+        {
+            quantized_bits = 16;
+        }
+        else if (process_rank == ROOT_PROCESS)
+        {
+            fprintf(stderr, "\nThe inputs do not fit 16 bits, multiplying them with the int kernel instead.\n");
+        }
+    }
+
+    if (quantized_bits != 0)
+    {
+        enum QuantizedIsa isa = detectQuantizedIsa();
+        if (process_rank == ROOT_PROCESS)
+        {
+            printf("\nKernel: quantized int%d (%s)\n", quantized_bits, quantizedIsaName(isa));
+        }
+
+        // The quantized kernels read the columns of matrix2 as the rows of its transpose, in the type of the kernel.
+        // The node leader builds it once in a shared matrix, which the other processes of the node read in place.
+        enum PackType quantized_type = quantized_bits == 8 ? PACK_INT8 : PACK_INT16;
+        MPI_Win quantized_window;
+        void *quantized_matrix2 = allocateNodeSharedBuffer(LENGTH_OF_METRIX, packTypeSize(quantized_type), node_comm, &quantized_window);
+        if (node_rank == 0)
+        {
+            if (transpose_matrix2)
+            {
+                packMatrix(matrix2, LENGTH_OF_METRIX, quantized_type, quantized_matrix2);
+            }
+            else
+            {
+                packTransposedMatrix(matrix2, COLUMNS, ROWS, quantized_type, quantized_matrix2);
+            }
+        }
+        MPI_Win_fence(0, quantized_window);
+
+        int matrix1_rows_length = product_matrix_rows * COLUMNS;
+        if (quantized_bits == 8)
+        {
+            // A signed matrix1 is moved to 0..255, which the kernel takes back out.
+            int matrix1_offset = 0;
+            for (int index = 0; matrix1_type == PACK_INT8 && index < matrix1_rows_length; index++)
+            {
+                if (matrix1_rows[index] < 0)
+                {
+                    matrix1_offset = 128;
+                    break;
+                }
+            }
+            uint8_t *quantized_matrix1 = allocatePacked(matrix1_rows_length, PACK_UINT8);
+            for (int index = 0; index < matrix1_rows_length; index++)
+            {
+                quantized_matrix1[index] = (uint8_t)(matrix1_rows[index] + matrix1_offset);
+            }
+            multiplyQuantized8(isa, quantized_matrix1, matrix1_offset, product_matrix_rows, COLUMNS, quantized_matrix2, ROWS, product_matrix);
+            free(quantized_matrix1);
+        }
+        else
+        {
+            int16_t *quantized_matrix1 = allocatePacked(matrix1_rows_length, PACK_INT16);
+            packMatrix(matrix1_rows, matrix1_rows_length, PACK_INT16, quantized_matrix1);
+            multiplyQuantized16(isa, quantized_matrix1, product_matrix_rows, COLUMNS, quantized_matrix2, ROWS, product_matrix);
+            free(quantized_matrix1);
+        }
+        MPI_Win_free(&quantized_window);
+    }
+    else if (transpose_matrix2)
+    {
+        // The column row_index of matrix2 is the row row_index of the transposed matrix2.
+        if (fused_epilogue)
         {
-            int product_matrix_index = product_matrix_row_index * ROWS + row_index;
-            product_matrix[product_matrix_index] = 0;
-            for (int column_index = 0; column_index < COLUMNS; column_index++)
+            multiplyRowsTransposedEpilogue(&epilogue, matrix1_rows, product_matrix_rows, COLUMNS, matrix2, ROWS, product_matrix, first_product_row);
+        }
+        else
+        {
+            multiplyRowsTransposed(matrix1_rows, product_matrix_rows, COLUMNS, matrix2, ROWS, product_matrix);
+        }
+    }
+    else
+    {
+        // Uses the kernel tuned for this configuration, calibrating it first with --autotune. Until then, the shapes
+        // of FIXED_KERNEL_SHAPES use the kernel unrolled for them at compile time (matrix-fixed.h).
+        struct KernelConfig kernel_config = defaultKernelConfig(COLUMNS, ROWS);
+        struct TuningKey tuning_key;
+        createTuningKey(&tuning_key, ROWS, COLUMNS, ROWS, "int32", process_size);
+        int tuning[3] = {0, kernel_config.type, kernel_config.tile};
+        if (process_rank == ROOT_PROCESS && !autotune && lookupTuning(&tuning_key, &kernel_config))
+        {
+            tuning[0] = 1;
+            tuning[1] = kernel_config.type;
+            tuning[2] = kernel_config.tile;
+        }
+        MPI_Bcast(tuning, 3, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+        kernel_config.type = tuning[1];
+        kernel_config.tile = tuning[2];
+
+        if (autotune)
+        {
+            double kernel_seconds;
+            kernel_config = calibrateKernels(matrix1_rows, product_matrix_rows, COLUMNS, matrix2, ROWS, MPI_COMM_WORLD, &kernel_seconds);
+            if (process_rank == ROOT_PROCESS)
             {
-                product_matrix[product_matrix_index] += matrix1_rows[column_index + COLUMNS * (product_matrix_row_index)] * matrix2[(column_index) * (ROWS) + row_index];
+                storeTuning(&tuning_key, kernel_config, kernel_seconds);
             }
         }
+        if (process_rank == ROOT_PROCESS)
+        {
+            printf("\nKernel: %s (tile %d, %s)\n", kernelName(kernel_config.type), kernel_config.tile,
+                   autotune ? "calibrated" : tuning[0] ? "tuned" : "default");
+        }
+        if (fused_epilogue)
+        {
+            multiplyRowsEpilogue(kernel_config, &epilogue, matrix1_rows, product_matrix_rows, COLUMNS, matrix2, ROWS, product_matrix, first_product_row);
+        }
+        else
+        {
+            multiplyRows(kernel_config, matrix1_rows, product_matrix_rows, COLUMNS, matrix2, ROWS, product_matrix);
+        }
     }
     
     // printf("\nproduct_matrix %d %d", process_rank, product_matrix_length);
     // printPartialMatrix(product_matrix, product_matrix_length);
 
+    stopPerfPhase(&counters, PHASE_COMPUTE);
+
     // Prepare matrices
     // int resultant_matrix[process_size][product_matrix_length];
     int *resultant_matrix;
@@ -158,10 +463,12 @@ char *argv[];
     }
 
     // Gather the row sums from the buffer and put it in the final matrix
+    startPerfPhase(&counters);
     MPI_Gather(product_matrix, product_matrix_length, MPI_INT, resultant_matrix, product_matrix_length, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
 
     // Blocks until all the processes call this method on the MPI_COMM_WORLD communicator 
     MPI_Barrier(MPI_COMM_WORLD);
+    stopPerfPhase(&counters, PHASE_GATHER);
 
     if (ROOT_PROCESS == process_rank)
     {
@@ -172,7 +479,7 @@ char *argv[];
 
         // Expected final product matrix.
         printf("\n\nExpected Matrix:\n");
-        multiplyMatrix(matrix1, ROWS, COLUMNS, matrix2, COLUMNS, ROWS);
+        multiplyMatrix(matrix1, ROWS, COLUMNS, original_matrix2, COLUMNS, ROWS, &epilogue, matrix3);
 
         printDashedLine(2);
         printf("Ending time: %f", ending_time);
@@ -185,19 +492,36 @@ char *argv[];
         printDashedLine(2);
     }
 
+    if (collect_counters)
+    {
+        const char *phase_names[PHASES] = {"distribute", "compute", "gather"};
+        reportPerfCounters(&counters, phase_names, PHASES, ROOT_PROCESS, MPI_COMM_WORLD, counters_file);
+    }
+    closePerfCounters(&counters);
+
+    // Releases the matrix2 of the node along with the node communicators.
+    MPI_Win_free(&matrix2_window);
+    freeNodeComms(&node_comm, &leader_comm);
+
     MPI_Finalize();
     if (ROOT_PROCESS == process_rank)
     {
         // Allocated only at the root processes
         free(matrix1);
+        if (original_matrix2 != matrix2)
+        {
+            free(original_matrix2);
+        }
+        free(matrix3);
         free(resultant_matrix);
     }
-    free(matrix2);
     free(product_matrix);
+    free(row_bias);
+    free(column_bias);
     return 0;
 }
 
-void multiplyMatrix(int *matrix1, int rows1, int columns1, int *matrix2, int rows2, int columns2)
+void multiplyMatrix(int *matrix1, int rows1, int columns1, int *matrix2, int rows2, int columns2, const struct Epilogue *epilogue, const int *matrix3)
 {
     int *result_matrix;
     if ((result_matrix = malloc(rows1 * columns2 * sizeof(int))) == NULL)
@@ -214,6 +538,7 @@ void multiplyMatrix(int *matrix1, int rows1, int columns1, int *matrix2, int row
             {
                 result_matrix[i * columns2 + j] += matrix1[i * rows2 + k] * matrix2[k * columns2 + j];
             }
+            result_matrix[i * columns2 + j] = applyEpilogue(epilogue, result_matrix[i * columns2 + j], matrix3 != NULL ? matrix3[i * columns2 + j] : 0, i, j);
         }
     }
     printMatrix(result_matrix, rows1, columns2);
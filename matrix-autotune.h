@@ -0,0 +1,251 @@
+#ifndef MATRIX_AUTOTUNE_H
+#define MATRIX_AUTOTUNE_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <float.h>
+#include <mpi.h>
+#include "matrix-kernels.h"
+// Selection of the local kernel and its tile size.
+// The candidates are timed on a few rows of the local block of every process and the slowest process decides the
+// time of a candidate. The winner is stored in a tuning file keyed by the shape, the element type, the number of
+// processes and the host, so the later runs of the same configuration reuse it without calibrating again.
+// Several jobs may share the tuning file: the updates are serialized with a lock file and every update replaces the
+// file atomically, so the readers never see a partial file and no job loses the entries of another one.
+
+// Tuning file used when MATRIX_TUNING_FILE is not set.
+#define DEFAULT_TUNING_FILE "matrix-tuning.txt"
+// Most multiply-adds a candidate may spend during the calibration, which bounds its overhead.
+#define CALIBRATION_WORK (1 << 22)
+// Timed runs of every candidate, after one untimed warm-up run; the fastest one counts.
+#define CALIBRATION_RUNS 3
+
+// Candidates timed by the calibration. The fixed kernel is only timed for the shapes which have one.
+static const struct KernelConfig KERNEL_CANDIDATES[] = {
+    {KERNEL_FIXED, 0},
+    {KERNEL_NAIVE, 0},
+    {KERNEL_STREAMING, 0},
+    {KERNEL_BLOCKED, 16},
+    {KERNEL_BLOCKED, 32},
+    {KERNEL_BLOCKED, 64},
+    {KERNEL_BLOCKED, 128},
+};
+
+// Configuration for which a kernel is tuned: rows x inner times inner x columns matrices.
+struct TuningKey
+{
+    int rows;
+    int inner;
+    int columns;
+    const char *element_type;
+    int process_size;
+    char host[MPI_MAX_PROCESSOR_NAME];
+};
+
+// Fills the key of the configuration with the name of the host of the calling process.
+static inline void createTuningKey(struct TuningKey *key, int rows, int inner, int columns, const char *element_type, int process_size)
+{
+    key->rows = rows;
+    key->inner = inner;
+    key->columns = columns;
+    key->element_type = element_type;
+    key->process_size = process_size;
+    int length;
+    MPI_Get_processor_name(key->host, &length);
+}
+
+// Path of the tuning file.
+static inline const char *tuningFilePath(void)
+{
+    const char *path = getenv("MATRIX_TUNING_FILE");
+    return path != NULL ? path : DEFAULT_TUNING_FILE;
+}
+
+// Parses a line of the tuning file: ROWS INNER COLUMNS TYPE PROCESSES HOST KERNEL TILE SECONDS.
+// Returns 1 if the line belongs to the key.
+static inline int parseTuningLine(const char *line, const struct TuningKey *key, struct KernelConfig *config)
+{
+    int rows, inner, columns, process_size, tile;
+    char element_type[32], host[256], kernel[32];
+    double seconds;
+    if (sscanf(line, "%d %d %d %31s %d %255s %31s %d %lf", &rows, &inner, &columns, element_type, &process_size, host, kernel, &tile, &seconds) != 9)
+    {
+        return 0;
+    }
+    if (rows != key->rows || inner != key->inner || columns != key->columns || process_size != key->process_size ||
+        strcmp(element_type, key->element_type) != 0 || strcmp(host, key->host) != 0)
+    {
+        return 0;
+    }
+    config->type = KERNEL_NAIVE;
+    config->tile = tile;
+    if (strcmp(kernel, kernelName(KERNEL_STREAMING)) == 0)
+    {
+        config->type = KERNEL_STREAMING;
+    }
+    else if (strcmp(kernel, kernelName(KERNEL_BLOCKED)) == 0 && tile > 0)
+    {
+        config->type = KERNEL_BLOCKED;
+    }
+    else if (strcmp(kernel, kernelName(KERNEL_FIXED)) == 0)
+    {
+        config->type = KERNEL_FIXED;
+    }
+    return 1;
+}
+
+// Looks up the kernel tuned for the key. Returns 0 if the configuration was never tuned.
+static inline int lookupTuning(const struct TuningKey *key, struct KernelConfig *config)
+{
+    FILE *file = fopen(tuningFilePath(), "r");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    char line[512];
+    int found = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        // The latest entry of the key wins.
+        if (parseTuningLine(line, key, config))
+        {
+            found = 1;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+// Stores the kernel tuned for the key, replacing the earlier entries of the key.
+static inline void storeTuning(const struct TuningKey *key, struct KernelConfig config, double seconds)
+{
+    const char *path = tuningFilePath();
+    char lock_path[4096], temporary_path[4096];
+    snprintf(lock_path, sizeof(lock_path), "%s.lock", path);
+    snprintf(temporary_path, sizeof(temporary_path), "%s.%ld.tmp", path, (long)getpid());
+
+    // Holds the lock from the read of the file to its replacement.
+    int lock = open(lock_path, O_RDWR | O_CREAT, 0644);
+    if (lock >= 0)
+    {
+        flock(lock, LOCK_EX);
+    }
+
+    // Keeps the entries of the other configurations.
+    char *kept = NULL;
+    size_t kept_length = 0;
+    FILE *file = fopen(path, "r");
+    if (file != NULL)
+    {
+        char line[512];
+        struct KernelConfig ignored;
+        while (fgets(line, sizeof(line), file) != NULL)
+        {
+            if (parseTuningLine(line, key, &ignored))
+            {
+                continue;
+            }
+            size_t line_length = strlen(line);
+            char *grown = realloc(kept, kept_length + line_length + 1);
+            if (grown == NULL)
+            {
+                break;
+            }
+            kept = grown;
+            memcpy(kept + kept_length, line, line_length + 1);
+            kept_length += line_length;
+        }
+        fclose(file);
+    }
+
+    // Writes the new file next to the old one and renames it over the old one.
+    int written = 0;
+    if ((file = fopen(temporary_path, "w")) != NULL)
+    {
+        if (kept != NULL)
+        {
+            fputs(kept, file);
+        }
+        fprintf(file, "%d %d %d %s %d %s %s %d %.9f\n", key->rows, key->inner, key->columns, key->element_type,
+                key->process_size, key->host, kernelName(config.type), config.tile, seconds);
+        written = fclose(file) == 0 && rename(temporary_path, path) == 0;
+    }
+    if (!written)
+    {
+        fprintf(stderr, "Tuning file %s cannot be written!\n", path);
+        remove(temporary_path);
+    }
+    free(kept);
+    if (lock >= 0)
+    {
+        flock(lock, LOCK_UN);
+        close(lock);
+    }
+}
+
+// Times every candidate on the first rows of the local block a and returns the fastest one.
+// Every candidate runs once untimed, to warm the caches up, and then CALIBRATION_RUNS times; its fastest run counts.
+// Collective over comm; every process returns the same kernel.
+static inline struct KernelConfig calibrateKernels(const int *a, int rows, int inner, const int *b, int columns, MPI_Comm comm, double *best_seconds)
+{
+    // Bounds the work of every candidate over all its runs, while timing at least one row.
+    long long row_work = (long long)inner * columns * (CALIBRATION_RUNS + 1);
+    int calibration_rows = row_work > 0 ? (int)(CALIBRATION_WORK / row_work) : rows;
+    if (calibration_rows < 1)
+    {
+        calibration_rows = 1;
+    }
+    if (calibration_rows > rows)
+    {
+        calibration_rows = rows;
+    }
+
+    int *c;
+    if ((c = malloc(((size_t)calibration_rows * columns + 1) * sizeof(int))) == NULL)
+    {
+        printf("Calibration matrix cannot be created!");
+        exit(1);
+    }
+    int candidate_count = sizeof(KERNEL_CANDIDATES) / sizeof(KERNEL_CANDIDATES[0]);
+    double seconds[candidate_count];
+    for (int candidate = 0; candidate < candidate_count; candidate++)
+    {
+        // Without a kernel for the shape, the fixed kernel would only time the naive one again.
+        if (KERNEL_CANDIDATES[candidate].type == KERNEL_FIXED && !hasFixedKernel(inner, columns))
+        {
+            seconds[candidate] = DBL_MAX;
+            continue;
+        }
+        multiplyRows(KERNEL_CANDIDATES[candidate], a, calibration_rows, inner, b, columns, c);
+        for (int run = 0; run < CALIBRATION_RUNS; run++)
+        {
+            double starting_time = MPI_Wtime();
+            multiplyRows(KERNEL_CANDIDATES[candidate], a, calibration_rows, inner, b, columns, c);
+            double run_seconds = MPI_Wtime() - starting_time;
+            if (run == 0 || run_seconds < seconds[candidate])
+            {
+                seconds[candidate] = run_seconds;
+            }
+        }
+    }
+    free(c);
+
+    // A candidate is as fast as its slowest process.
+    MPI_Allreduce(MPI_IN_PLACE, seconds, candidate_count, MPI_DOUBLE, MPI_MAX, comm);
+    int best = 0;
+    for (int candidate = 1; candidate < candidate_count; candidate++)
+    {
+        if (seconds[candidate] < seconds[best])
+        {
+            best = candidate;
+        }
+    }
+    *best_seconds = seconds[best];
+    return KERNEL_CANDIDATES[best];
+}
+
+#endif
@@ -0,0 +1,302 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <mpi.h>
+#include <time.h>
+#include <string.h>
+#include <limits.h>
+#include "matrix-resident.h"
+// Multiplies the chain of matrices A1 * A2 * ... * An, where Ai is a DIMENSION(i-1) x DIMENSION(i) matrix.
+// The order of the multiplications is chosen by dynamic programming over a cost model of the multiply-adds and
+// of the elements each process receives, and the intermediate products stay distributed across the processes,
+// so the root process only scatters the inputs once and gathers the final product once.
+
+// Root process.
+const int ROOT_PROCESS = 0;
+// Cost of one multiply-add relative to the cost of one element received by a process.
+const double FLOP_COST = 1.0;
+// Default cost of one element received by a process, in multiply-adds.
+const double DEFAULT_WORD_COST = 8.0;
+
+// Generates the matrix of provided size.
+void generateMatrix(long long *matrix, int rows, int columns);
+// Cost of multiplying the distributed rows x inner and inner x columns matrices on process_size processes.
+double stepCost(int rows, int inner, int columns, int process_size, double word_cost);
+// Fills the cheapest cost and the split of every sub-chain; split[i * count + j] = k multiplies (Ai..Ak)(Ak+1..Aj).
+double optimalParenthesization(const int *dimensions, int count, int process_size, double word_cost, double *cost, int *split);
+// Prints the parenthesization of the sub-chain Ai..Aj.
+void printParenthesization(const int *split, int count, int i, int j);
+// Multiplies the sub-chain Ai..Aj of the distributed matrices and returns the block of the product held by the process.
+long long *multiplyChain(long long **blocks, const int *dimensions, const int *split, int count, int i, int j, MPI_Comm comm);
+// Prints the dashed lines.
+void printDashedLine(int times);
+
+int main(argc, argv) int argc;
+char *argv[];
+{
+    // Dimensions of the chain and the options.
+    int dimensions[argc];
+    int dimension_count = 0;
+    double word_cost = DEFAULT_WORD_COST;
+    for (int arg_index = 1; arg_index < argc; arg_index++)
+    {
+        if (strncmp(argv[arg_index], "--word-cost=", 12) == 0)
+        {
+            word_cost = atof(argv[arg_index] + 12);
+        }
+        else if (strncmp(argv[arg_index], "--", 2) == 0 || atoi(argv[arg_index]) <= 0)
+        {
+            fprintf(stderr, "Usage: unknown option or dimension %s (supported: --word-cost=COST)\n", argv[arg_index]);
+            exit(1);
+        }
+        else
+        {
+            dimensions[dimension_count++] = atoi(argv[arg_index]);
+        }
+    }
+    if (dimension_count < 3)
+    {
+        fprintf(stderr, "Usage: please enter the dimensions of the chain(D0<space>D1<space>D2...<return>)\n");
+        exit(1);
+    }
+    // Number of matrices in the chain.
+    const int COUNT = dimension_count - 1;
+    // An element of A1 x ... x An is at most 9^n times the product of the inner dimensions D1 ... Dn-1, and so is
+    // every intermediate and partial sum of any parenthesization; all of them must fit a long long.
+    long long largest_element = 1;
+    for (int index = 0; index < COUNT; index++)
+    {
+        long long factor = index == 0 ? 9 : 9LL * dimensions[index];
+        if (largest_element > LLONG_MAX / factor)
+        {
+            fprintf(stderr, "Usage: the products of the chain may not fit 64 bits, please enter fewer or smaller dimensions\n");
+            exit(1);
+        }
+        largest_element *= factor;
+    }
+
+    int process_rank, process_size;
+
+    if (MPI_Init(&argc, &argv) != MPI_SUCCESS)
+    {
+        perror("Error initializing MPI!");
+        exit(1);
+    }
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank); /* get current process id */
+    MPI_Comm_size(MPI_COMM_WORLD, &process_size); /* get number of processes */
+
+    // Every process computes the same parenthesization, so it does not have to be sent.
+    double *cost;
+    int *split;
+    if ((cost = malloc(COUNT * COUNT * sizeof(double))) == NULL || (split = malloc(COUNT * COUNT * sizeof(int))) == NULL)
+    {
+        printf("Parenthesization cannot be created!");
+        exit(1);
+    }
+    double chain_cost = optimalParenthesization(dimensions, COUNT, process_size, word_cost, cost, split);
+
+    // Will be allocated memory only by the root process
+    long long *matrices[COUNT];
+    // To store the starting time.
+    double starting_time = 0;
+
+    if (process_rank == ROOT_PROCESS)
+    {
+        srand(time(NULL));
+        for (int index = 0; index < COUNT; index++)
+        {
+            if ((matrices[index] = malloc((size_t)dimensions[index] * dimensions[index + 1] * sizeof(long long))) == NULL)
+            {
+                printf("Matrix %d cannot be created!", index + 1);
+                exit(1);
+            }
+            generateMatrix(matrices[index], dimensions[index], dimensions[index + 1]);
+        }
+
+        printf("\nParenthesization: ");
+        printParenthesization(split, COUNT, 0, COUNT - 1);
+        printf("\nEstimated cost: %.0f\n", chain_cost);
+
+        // Notes the starting time.
+        starting_time = MPI_Wtime();
+        printDashedLine(2);
+        printf("Starting time: %f", starting_time);
+        printDashedLine(2);
+    }
+
+    // Scatters the rows of every matrix once; the intermediates never leave the processes.
+    long long *blocks[COUNT];
+    for (int index = 0; index < COUNT; index++)
+    {
+        blocks[index] = scatterResident(process_rank == ROOT_PROCESS ? matrices[index] : NULL, dimensions[index], dimensions[index + 1], ROOT_PROCESS, MPI_COMM_WORLD);
+    }
+
+    long long *product_block = multiplyChain(blocks, dimensions, split, COUNT, 0, COUNT - 1, MPI_COMM_WORLD);
+
+    const int ROWS = dimensions[0];
+    const int COLUMNS = dimensions[COUNT];
+    long long *resultant_matrix = NULL;
+    if (process_rank == ROOT_PROCESS)
+    {
+        if ((resultant_matrix = malloc((size_t)ROWS * COLUMNS * sizeof(long long))) == NULL)
+        {
+            printf("Resultant matrix cannot be created!");
+            exit(1);
+        }
+    }
+    // Gathers only the final product at the root process.
+    gatherResident(product_block, ROWS, COLUMNS, resultant_matrix, ROOT_PROCESS, MPI_COMM_WORLD);
+
+    if (process_rank == ROOT_PROCESS)
+    {
+        // Note the ending time.
+        double ending_time = MPI_Wtime();
+        printf("Product Matrix:\n");
+        printResidentMatrix(resultant_matrix, ROWS, COLUMNS);
+
+        // Expected final product matrix, multiplied from left to right.
+        long long *expected_matrix = matrices[0];
+        for (int index = 1; index < COUNT; index++)
+        {
+            long long *next_matrix;
+            if ((next_matrix = malloc((size_t)ROWS * dimensions[index + 1] * sizeof(long long))) == NULL)
+            {
+                printf("Expected matrix cannot be created!");
+                exit(1);
+            }
+            multiplyLocal(expected_matrix, ROWS, dimensions[index], matrices[index], dimensions[index + 1], next_matrix);
+            if (expected_matrix != matrices[0])
+            {
+                free(expected_matrix);
+            }
+            expected_matrix = next_matrix;
+        }
+        printf("\n\nExpected Matrix:\n");
+        printResidentMatrix(expected_matrix, ROWS, COLUMNS);
+        if (expected_matrix != matrices[0])
+        {
+            free(expected_matrix);
+        }
+
+        printDashedLine(2);
+        printf("Ending time: %f", ending_time);
+        printDashedLine(2);
+
+        // Time taken.
+        double calc_time = ending_time - starting_time;
+        printDashedLine(2);
+        printf("Took %f", calc_time);
+        printDashedLine(2);
+
+        for (int index = 0; index < COUNT; index++)
+        {
+            free(matrices[index]);
+        }
+        free(resultant_matrix);
+    }
+
+    for (int index = 0; index < COUNT; index++)
+    {
+        free(blocks[index]);
+    }
+    free(product_block);
+    free(cost);
+    free(split);
+
+    MPI_Finalize();
+    return 0;
+}
+
+double stepCost(int rows, int inner, int columns, int process_size, double word_cost)
+{
+    // Every process multiplies its share of the rows and receives the blocks of the right operand it does not hold.
+    double flops = (double)rows * inner * columns / process_size;
+    double words = (double)inner * columns * (process_size - 1) / process_size;
+    return flops * FLOP_COST + words * word_cost;
+}
+
+double optimalParenthesization(const int *dimensions, int count, int process_size, double word_cost, double *cost, int *split)
+{
+    for (int i = 0; i < count; i++)
+    {
+        cost[i * count + i] = 0;
+        split[i * count + i] = i;
+    }
+    // Solves the sub-chains in the order of their length, so both halves of every split are already solved.
+    for (int length = 2; length <= count; length++)
+    {
+        for (int i = 0; i + length - 1 < count; i++)
+        {
+            int j = i + length - 1;
+            cost[i * count + j] = -1;
+            for (int k = i; k < j; k++)
+            {
+                double split_cost = cost[i * count + k] + cost[(k + 1) * count + j] +
+                                    stepCost(dimensions[i], dimensions[k + 1], dimensions[j + 1], process_size, word_cost);
+                if (cost[i * count + j] < 0 || split_cost < cost[i * count + j])
+                {
+                    cost[i * count + j] = split_cost;
+                    split[i * count + j] = k;
+                }
+            }
+        }
+    }
+    return cost[count - 1];
+}
+
+void printParenthesization(const int *split, int count, int i, int j)
+{
+    if (i == j)
+    {
+        printf("A%d", i + 1);
+        return;
+    }
+    int k = split[i * count + j];
+    printf("(");
+    printParenthesization(split, count, i, k);
+    printParenthesization(split, count, k + 1, j);
+    printf(")");
+}
+
+long long *multiplyChain(long long **blocks, const int *dimensions, const int *split, int count, int i, int j, MPI_Comm comm)
+{
+    if (i == j)
+    {
+        return blocks[i];
+    }
+    int k = split[i * count + j];
+    long long *left = multiplyChain(blocks, dimensions, split, count, i, k, comm);
+    long long *right = multiplyChain(blocks, dimensions, split, count, k + 1, j, comm);
+    long long *product = multiplyResident(left, dimensions[i], dimensions[k + 1], right, dimensions[j + 1], comm);
+
+    // Releases the intermediates; the blocks of the input matrices are released by the caller.
+    if (k > i)
+    {
+        free(left);
+    }
+    if (k + 1 < j)
+    {
+        free(right);
+    }
+    return product;
+}
+
+void generateMatrix(long long *matrix, int rows, int columns)
+{
+    // Elements of 0..9, which main bounds the products of the chain with.
+    for (int index = 0; index < rows * columns; index++)
+    {
+        matrix[index] = rand() % 10;
+    }
+}
+
+void printDashedLine(int times)
+{
+    int times_done = times;
+    printf("\n");
+    while (times_done > 0)
+    {
+        printf("-------------------------------\n");
+        times_done--;
+    }
+}
@@ -0,0 +1,286 @@
+#ifndef MATRIX_COUNTERS_H
+#define MATRIX_COUNTERS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <mpi.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+// Hardware performance counters of every process, collected per phase of a driver with Linux perf_event_open.
+// Every counter which cannot be opened (no PMU, perf_event_paranoid, seccomp, another OS) is silently left out
+// and reported as n/a, so the drivers run the same with or without them. Only the user-space work of the calling
+// thread is counted. The counters are opened as one group led by the cycles (or by the first event which opens),
+// so they are scheduled together and count the same instructions; when the kernel multiplexes the group with
+// other events, the counts of a phase are scaled by the times the group was enabled and running during that phase.
+// A phase in which the group was never scheduled, or could not be read, has no counts and is reported as n/a.
+//
+// Usage:
+//     struct PerfCounters counters;
+//     openPerfCounters(&counters, enabled);
+//     startPerfPhase(&counters); ... stopPerfPhase(&counters, PHASE); ...
+//     reportPerfCounters(&counters, phase_names, phases, root, comm, csv_file);
+//     closePerfCounters(&counters);
+
+// Number of phases which can be counted.
+#define PERF_MAX_PHASES 8
+
+// Counted events.
+enum PerfEvent
+{
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_STALLED_FRONTEND,
+    PERF_STALLED_BACKEND,
+    PERF_EVENTS
+};
+
+struct PerfCounters
+{
+    // File descriptor of every event, -1 when it is not counted.
+    int fds[PERF_EVENTS];
+    // Event which leads the group, -1 when no event is counted.
+    int leader;
+    // Counts and seconds of every phase, summed over the times the phase ran.
+    long long counts[PERF_MAX_PHASES][PERF_EVENTS];
+    double seconds[PERF_MAX_PHASES];
+    // Whether the counts of the phase are missing a run in which the group was never scheduled or could not be read.
+    int uncounted[PERF_MAX_PHASES];
+    double phase_start;
+    // Values and times enabled and running of the group when the current phase started.
+    unsigned long long start_values[PERF_EVENTS];
+    unsigned long long start_enabled;
+    unsigned long long start_running;
+};
+
+// Name of the event, used in the reports.
+static inline const char *perfEventName(enum PerfEvent event)
+{
+    static const char *names[PERF_EVENTS] = {"cycles", "instructions", "l1d-misses", "llc-misses", "stalled-frontend", "stalled-backend"};
+    return names[event];
+}
+
+#ifdef __linux__
+// Opens one counter of the calling thread in the group of group_fd, or as the disabled leader of a new group when
+// group_fd is -1. Returns -1 if it is not available.
+static inline int openPerfEvent(unsigned int type, unsigned long long config, int group_fd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    // The members follow the leader, which enables and disables the whole group.
+    attr.disabled = group_fd < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+// Reads the value of every counted event and the times the group was enabled and running. Returns 0 on failure.
+static inline int readPerfGroup(const struct PerfCounters *counters, unsigned long long values[PERF_EVENTS],
+                                unsigned long long *enabled, unsigned long long *running)
+{
+    // Number of events, time enabled, time running, then the value of every event in the order they were opened.
+    unsigned long long group[3 + PERF_EVENTS];
+    if (read(counters->fds[counters->leader], group, sizeof(group)) < (ssize_t)(3 * sizeof(unsigned long long)))
+    {
+        return 0;
+    }
+    *enabled = group[1];
+    *running = group[2];
+    unsigned long long member = 0;
+    for (int event = 0; event < PERF_EVENTS; event++)
+    {
+        values[event] = 0;
+        if (counters->fds[event] >= 0 && member < group[0])
+        {
+            values[event] = group[3 + member++];
+        }
+    }
+    return 1;
+}
+#endif
+
+// Opens the counters when enabled; every counter is left out otherwise.
+static inline void openPerfCounters(struct PerfCounters *counters, int enabled)
+{
+    memset(counters, 0, sizeof(*counters));
+    counters->leader = -1;
+    for (int event = 0; event < PERF_EVENTS; event++)
+    {
+        counters->fds[event] = -1;
+    }
+#ifdef __linux__
+    if (!enabled)
+    {
+        return;
+    }
+    const unsigned long long l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    const unsigned int types[PERF_EVENTS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                             PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+    const unsigned long long configs[PERF_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, l1d_read_miss,
+                                                     PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_STALLED_CYCLES_FRONTEND,
+                                                     PERF_COUNT_HW_STALLED_CYCLES_BACKEND};
+    // The first event which opens leads the group; a member which cannot join the group is left out.
+    for (int event = 0; event < PERF_EVENTS; event++)
+    {
+        int group_fd = counters->leader >= 0 ? counters->fds[counters->leader] : -1;
+        counters->fds[event] = openPerfEvent(types[event], configs[event], group_fd);
+        if (counters->fds[event] >= 0 && counters->leader < 0)
+        {
+            counters->leader = event;
+        }
+    }
+#else
+    (void)enabled;
+#endif
+}
+
+// Starts counting a phase.
+static inline void startPerfPhase(struct PerfCounters *counters)
+{
+#ifdef __linux__
+    // The times enabled and running are not reset with the counts, so the phase is measured from where they stand.
+    if (counters->leader >= 0)
+    {
+        if (!readPerfGroup(counters, counters->start_values, &counters->start_enabled, &counters->start_running))
+        {
+            memset(counters->start_values, 0, sizeof(counters->start_values));
+            counters->start_enabled = counters->start_running = 0;
+        }
+        ioctl(counters->fds[counters->leader], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+    counters->phase_start = MPI_Wtime();
+}
+
+// Stops counting and adds the counts since startPerfPhase to the phase.
+static inline void stopPerfPhase(struct PerfCounters *counters, int phase)
+{
+    counters->seconds[phase] += MPI_Wtime() - counters->phase_start;
+#ifdef __linux__
+    if (counters->leader < 0)
+    {
+        return;
+    }
+    ioctl(counters->fds[counters->leader], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    unsigned long long values[PERF_EVENTS], enabled, running;
+    if (!readPerfGroup(counters, values, &enabled, &running))
+    {
+        counters->uncounted[phase] = 1;
+        return;
+    }
+    // The group only counted for running of the enabled nanoseconds of the phase; nothing is known of the phase
+    // when it never ran.
+    unsigned long long phase_enabled = enabled - counters->start_enabled, phase_running = running - counters->start_running;
+    if (phase_running == 0)
+    {
+        counters->uncounted[phase] = 1;
+        return;
+    }
+    for (int event = 0; event < PERF_EVENTS; event++)
+    {
+        if (counters->fds[event] < 0)
+        {
+            continue;
+        }
+        unsigned long long value = values[event] - counters->start_values[event];
+        if (phase_running < phase_enabled)
+        {
+            value = (unsigned long long)((double)value * phase_enabled / phase_running);
+        }
+        counters->counts[phase][event] += (long long)value;
+    }
+#endif
+}
+
+// Gathers the counters of every process of comm on the root process, which prints the lowest, average and highest
+// count of every phase and event, and appends them to csv_file (phase,event,processes,min,avg,max) when it is not NULL.
+// An event of a phase is reported over the processes which could count it during the phase. Collective over comm.
+static inline void reportPerfCounters(struct PerfCounters *counters, const char *phase_names[], int phases, int root, MPI_Comm comm, const char *csv_file)
+{
+    int process_rank;
+    MPI_Comm_rank(comm, &process_rank);
+
+    // Seconds are reported as one more event, counted by every process.
+    int available[PERF_MAX_PHASES][PERF_EVENTS + 1], processes[PERF_MAX_PHASES][PERF_EVENTS + 1];
+    for (int phase = 0; phase < phases; phase++)
+    {
+        for (int event = 0; event < PERF_EVENTS; event++)
+        {
+            available[phase][event] = counters->fds[event] >= 0 && !counters->uncounted[phase];
+        }
+        available[phase][PERF_EVENTS] = 1;
+    }
+    MPI_Allreduce(available, processes, phases * (PERF_EVENTS + 1), MPI_INT, MPI_SUM, comm);
+
+    FILE *csv = NULL;
+    if (process_rank == root && csv_file != NULL && (csv = fopen(csv_file, "a")) == NULL)
+    {
+        fprintf(stderr, "Counters file %s cannot be opened!\n", csv_file);
+    }
+    if (process_rank == root)
+    {
+        printf("\nCounters (lowest / average / highest process):\n");
+    }
+    for (int phase = 0; phase < phases; phase++)
+    {
+        for (int event = 0; event <= PERF_EVENTS; event++)
+        {
+            // The processes without the event take part with values which do not change the result.
+            double value = event == PERF_EVENTS ? counters->seconds[phase] : (double)counters->counts[phase][event];
+            int counted = available[phase][event];
+            double low = counted ? value : DBL_MAX, high = counted ? value : 0, sum = counted ? value : 0;
+            double lowest, highest, total;
+            MPI_Reduce(&low, &lowest, 1, MPI_DOUBLE, MPI_MIN, root, comm);
+            MPI_Reduce(&high, &highest, 1, MPI_DOUBLE, MPI_MAX, root, comm);
+            MPI_Reduce(&sum, &total, 1, MPI_DOUBLE, MPI_SUM, root, comm);
+            if (process_rank != root)
+            {
+                continue;
+            }
+            const char *event_name = event == PERF_EVENTS ? "seconds" : perfEventName(event);
+            if (processes[phase][event] == 0)
+            {
+                printf("%-12s %-18s n/a\n", phase_names[phase], event_name);
+                continue;
+            }
+            printf("%-12s %-18s %.6g / %.6g / %.6g\n", phase_names[phase], event_name, lowest, total / processes[phase][event], highest);
+            if (csv != NULL)
+            {
+                fprintf(csv, "%s,%s,%d,%.9g,%.9g,%.9g\n", phase_names[phase], event_name, processes[phase][event], lowest, total / processes[phase][event], highest);
+            }
+        }
+    }
+    if (csv != NULL)
+    {
+        fclose(csv);
+    }
+}
+
+// Closes the counters.
+static inline void closePerfCounters(struct PerfCounters *counters)
+{
+#ifdef __linux__
+    // The members are closed before their leader.
+    for (int event = PERF_EVENTS - 1; event >= 0; event--)
+    {
+        if (counters->fds[event] >= 0)
+        {
+            close(counters->fds[event]);
+            counters->fds[event] = -1;
+        }
+    }
+    counters->leader = -1;
+#endif
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef MATRIX_DATATYPES_H
+#define MATRIX_DATATYPES_H
+
+#include <mpi.h>
+// MPI derived datatypes which describe the parts of a row-major matrix in place,
+// so MPI sends them straight from the matrix without copying them into a buffer first.
+
+// Describes one row of a matrix with columns elements of the element type.
+static inline MPI_Datatype createRowType(int columns, MPI_Datatype element)
+{
+    MPI_Datatype row_type;
+    MPI_Type_contiguous(columns, element, &row_type);
+    MPI_Type_commit(&row_type);
+    return row_type;
+}
+
+// Describes one column of a rows x columns matrix: rows elements which are columns elements apart.
+static inline MPI_Datatype createColumnType(int rows, int columns, MPI_Datatype element)
+{
+    MPI_Datatype column_type;
+    MPI_Type_vector(rows, 1, columns, element, &column_type);
+    MPI_Type_commit(&column_type);
+    return column_type;
+}
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef MATRIX_EPILOGUE_H
+#define MATRIX_EPILOGUE_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "matrix-kernels.h"
+// Epilogue fused into the local kernels: every element of c becomes
+//     function(alpha * (a x b) + beta * c + row_bias[row] + column_bias[column])
+// while the block of the product is still in the cache, instead of one more pass over the whole product for every step.
+// c is only read when beta is not zero, so it may be left uninitialized otherwise; the biases are optional (NULL).
+// The rows are numbered from first_row, so the biases of the whole product can be given to every block of rows.
+
+// Bytes of the panel of the product computed before the epilogue is applied to it; fits the L1 cache.
+#define EPILOGUE_PANEL_BYTES (32 * 1024)
+
+// Elementwise functions applied last.
+enum EpilogueFunction
+{
+    EPILOGUE_NONE,
+    // max(x, 0)
+    EPILOGUE_RELU,
+    // |x|
+    EPILOGUE_ABS,
+    // x clamped to -128..127, to requantize the product to int8.
+    EPILOGUE_CLAMP8
+};
+
+struct Epilogue
+{
+    int alpha;
+    int beta;
+    // Bias of every row and of every column of the whole product, or NULL.
+    const int *row_bias;
+    const int *column_bias;
+    enum EpilogueFunction function;
+};
+
+// Epilogue which leaves the product as it is.
+static inline struct Epilogue identityEpilogue(void)
+{
+    struct Epilogue epilogue = {1, 0, NULL, NULL, EPILOGUE_NONE};
+    return epilogue;
+}
+
+// Returns 1 if the epilogue leaves the product as it is, so the plain kernels can be used.
+static inline int isIdentityEpilogue(const struct Epilogue *epilogue)
+{
+    return epilogue->alpha == 1 && epilogue->beta == 0 && epilogue->row_bias == NULL && epilogue->column_bias == NULL &&
+           epilogue->function == EPILOGUE_NONE;
+}
+
+// Name of the function, used in the reports and by the --function option.
+static inline const char *epilogueFunctionName(enum EpilogueFunction function)
+{
+    switch (function)
+    {
+    case EPILOGUE_RELU:
+        return "relu";
+    case EPILOGUE_ABS:
+        return "abs";
+    case EPILOGUE_CLAMP8:
+        return "clamp8";
+    default:
+        return "none";
+    }
+}
+
+// Parses the name of a function. Returns 0 if it is not known.
+static inline int parseEpilogueFunction(const char *name, enum EpilogueFunction *function)
+{
+    for (int candidate = EPILOGUE_NONE; candidate <= EPILOGUE_CLAMP8; candidate++)
+    {
+        if (strcmp(name, epilogueFunctionName(candidate)) == 0)
+        {
+            *function = candidate;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Options of the drivers which set the epilogue, for their usage messages.
+#define EPILOGUE_OPTIONS_USAGE "--alpha=N, --beta=N, --bias=row|column|both, --function=relu|abs|clamp8"
+
+// Parses one of the EPILOGUE_OPTIONS_USAGE options into the epilogue; --bias only enables the biases, which the
+// driver generates. Returns 0 if the option is not one of them or is malformed.
+static inline int parseEpilogueOption(const char *option, struct Epilogue *epilogue, int *row_bias_enabled, int *column_bias_enabled)
+{
+    enum EpilogueFunction function;
+    if (strncmp(option, "--alpha=", 8) == 0)
+    {
+        epilogue->alpha = atoi(option + 8);
+    }
+    else if (strncmp(option, "--beta=", 7) == 0)
+    {
+        epilogue->beta = atoi(option + 7);
+    }
+    else if (strncmp(option, "--bias=", 7) == 0 &&
+             (strcmp(option + 7, "row") == 0 || strcmp(option + 7, "column") == 0 || strcmp(option + 7, "both") == 0))
+    {
+        *row_bias_enabled = strcmp(option + 7, "column") != 0;
+        *column_bias_enabled = strcmp(option + 7, "row") != 0;
+    }
+    else if (strncmp(option, "--function=", 11) == 0 && parseEpilogueFunction(option + 11, &function))
+    {
+        epilogue->function = function;
+    }
+    else
+    {
+        return 0;
+    }
+    return 1;
+}
+
+// Fills the length long biases of the rows and of the columns with random values of -50..49, or with zeros when
+// they are not enabled.
+static inline void generateEpilogueBiases(int *row_bias, int *column_bias, int length, int row_bias_enabled, int column_bias_enabled)
+{
+    for (int index = 0; index < length; index++)
+    {
+        row_bias[index] = row_bias_enabled ? rand() % 100 - 50 : 0;
+        column_bias[index] = column_bias_enabled ? rand() % 100 - 50 : 0;
+    }
+}
+
+// Applies the epilogue to the product sum of the element (row, column) whose previous value is c_element.
+static inline int applyEpilogue(const struct Epilogue *epilogue, int sum, int c_element, int row, int column)
+{
+    int value = epilogue->alpha * sum;
+    if (epilogue->beta != 0)
+    {
+        value += epilogue->beta * c_element;
+    }
+    if (epilogue->row_bias != NULL)
+    {
+        value += epilogue->row_bias[row];
+    }
+    if (epilogue->column_bias != NULL)
+    {
+        value += epilogue->column_bias[column];
+    }
+    switch (epilogue->function)
+    {
+    case EPILOGUE_RELU:
+        return value > 0 ? value : 0;
+    case EPILOGUE_ABS:
+        return value < 0 ? -value : value;
+    case EPILOGUE_CLAMP8:
+        return value < -128 ? -128 : value > 127 ? 127 : value;
+    default:
+        return value;
+    }
+}
+
+// Applies the epilogue to the rows x columns products, writing them into c.
+static inline void applyEpilogueRows(const struct Epilogue *epilogue, const int *products, int rows, int columns, int first_row, int *c)
+{
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            int index = row * columns + column;
+            c[index] = applyEpilogue(epilogue, products[index], epilogue->beta != 0 ? c[index] : 0, first_row + row, column);
+        }
+    }
+}
+
+// Multiplies the rows of a by b with the configured kernel, one panel of EPILOGUE_PANEL_BYTES at a time, and applies
+// the epilogue to every panel while it is in the cache.
+static inline void multiplyRowsEpilogue(struct KernelConfig config, const struct Epilogue *epilogue, const int *a, int rows, int inner,
+                                        const int *b, int columns, int *c, int first_row)
+{
+    int panel_rows = EPILOGUE_PANEL_BYTES / (int)(columns * sizeof(int));
+    panel_rows = panel_rows < 1 ? 1 : panel_rows > rows ? rows : panel_rows;
+    int *panel;
+    if ((panel = malloc(((size_t)panel_rows * columns + 1) * sizeof(int))) == NULL)
+    {
+        printf("Panel of the product cannot be created!");
+        exit(1);
+    }
+    for (int row = 0; row < rows; row += panel_rows)
+    {
+        int rows_done = rows - row < panel_rows ? rows - row : panel_rows;
+        const int *a_panel = a + (size_t)row * inner;
+        multiplyRows(config, a_panel, rows_done, inner, b, columns, panel);
+        applyEpilogueRows(epilogue, panel, rows_done, columns, first_row + row, c + (size_t)row * columns);
+    }
+    free(panel);
+}
+
+// multiplyRowsTransposed with the epilogue applied to every inner product as soon as it is computed.
+static inline void multiplyRowsTransposedEpilogue(const struct Epilogue *epilogue, const int *a, int rows, int inner,
+                                                  const int *b_transposed, int columns, int *c, int first_row)
+{
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            int sum = 0;
+            for (int k = 0; k < inner; k++)
+            {
+                sum += a[row * inner + k] * b_transposed[column * inner + k];
+            }
+            c[row * columns + column] = applyEpilogue(epilogue, sum, epilogue->beta != 0 ? c[row * columns + column] : 0, first_row + row, column);
+        }
+    }
+}
+
+#endif
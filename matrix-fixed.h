@@ -0,0 +1,112 @@
+#ifndef MATRIX_FIXED_H
+#define MATRIX_FIXED_H
+
+// Kernels specialized at compile time for the shapes which are known when the drivers are built.
+// Every shape of FIXED_KERNEL_SHAPES(X) generates a kernel whose loop bounds are constants, so the compiler fully
+// unrolls the inner loops and keeps a row of the product in registers; every length of FIXED_DOT_LENGTHS(X) generates
+// an inner product of that length. The dispatchers pick them at run time when the shape matches and return 0
+// otherwise, so the caller falls back to its generic kernel.
+//
+// The lists can be replaced when building, e.g.
+//     mpicc -D'FIXED_KERNEL_SHAPES(X)=X(24, 48)' -D'FIXED_DOT_LENGTHS(X)=X(24)' matrix-async.c -o matrix
+
+// Shapes (INNER, COLUMNS) of the block kernels: rows x INNER times INNER x COLUMNS.
+// 32 x 64 is the matrix2 of matrix-sync.c.
+#ifndef FIXED_KERNEL_SHAPES
+#define FIXED_KERNEL_SHAPES(X) \
+    X(4, 4)                    \
+    X(8, 8)                    \
+    X(16, 16)                  \
+    X(32, 32)                  \
+    X(32, 64)
+#endif
+
+// Lengths of the inner products; 32 is the COLUMNS of matrix-sync.c.
+#ifndef FIXED_DOT_LENGTHS
+#define FIXED_DOT_LENGTHS(X) \
+    X(16)                    \
+    X(32)                    \
+    X(64)
+#endif
+
+// Multiplies the rows x INNER a by the INNER x COLUMNS b into c, one row of c at a time.
+#define DEFINE_FIXED_KERNEL(INNER, COLUMNS)                                                               \
+    static inline void multiplyRowsFixed##INNER##x##COLUMNS(const int *a, int rows, const int *b, int *c) \
+    {                                                                                                     \
+        for (int row = 0; row < rows; row++)                                                              \
+        {                                                                                                 \
+            int sums[COLUMNS] = {0};                                                                      \
+            _Pragma("GCC unroll 64") for (int k = 0; k < (INNER); k++)                                    \
+            {                                                                                             \
+                int a_element = a[row * (INNER) + k];                                                     \
+                _Pragma("GCC unroll 64") for (int column = 0; column < (COLUMNS); column++)               \
+                {                                                                                         \
+                    sums[column] += a_element * b[k * (COLUMNS) + column];                                \
+                }                                                                                         \
+            }                                                                                             \
+            for (int column = 0; column < (COLUMNS); column++)                                            \
+            {                                                                                             \
+                c[row * (COLUMNS) + column] = sums[column];                                               \
+            }                                                                                             \
+        }                                                                                                 \
+    }
+
+// Inner product of two LENGTH long rows.
+#define DEFINE_FIXED_DOT(LENGTH)                                    \
+    static inline int dotFixed##LENGTH(const int *a, const int *b)  \
+    {                                                               \
+        int sum = 0;                                                \
+        _Pragma("GCC unroll 64") for (int k = 0; k < (LENGTH); k++) \
+        {                                                           \
+            sum += a[k] * b[k];                                     \
+        }                                                           \
+        return sum;                                                 \
+    }
+
+FIXED_KERNEL_SHAPES(DEFINE_FIXED_KERNEL)
+FIXED_DOT_LENGTHS(DEFINE_FIXED_DOT)
+
+// Returns 1 if a kernel is specialized for inner x columns.
+static inline int hasFixedKernel(int inner, int columns)
+{
+#define MATCH_FIXED_KERNEL(INNER, COLUMNS)        \
+    if (inner == (INNER) && columns == (COLUMNS)) \
+    {                                             \
+        return 1;                                 \
+    }
+    FIXED_KERNEL_SHAPES(MATCH_FIXED_KERNEL)
+#undef MATCH_FIXED_KERNEL
+    return 0;
+}
+
+// Multiplies the rows x inner a by the inner x columns b into c with the specialized kernel.
+// Returns 0, without touching c, if no kernel is specialized for the shape.
+static inline int multiplyRowsFixed(const int *a, int rows, int inner, const int *b, int columns, int *c)
+{
+#define DISPATCH_FIXED_KERNEL(INNER, COLUMNS)                \
+    if (inner == (INNER) && columns == (COLUMNS))            \
+    {                                                        \
+        multiplyRowsFixed##INNER##x##COLUMNS(a, rows, b, c); \
+        return 1;                                            \
+    }
+    FIXED_KERNEL_SHAPES(DISPATCH_FIXED_KERNEL)
+#undef DISPATCH_FIXED_KERNEL
+    return 0;
+}
+
+// Stores the inner product of the two length long rows into sum with the specialized kernel.
+// Returns 0 if no kernel is specialized for the length.
+static inline int dotFixed(const int *a, const int *b, int length, int *sum)
+{
+#define DISPATCH_FIXED_DOT(LENGTH)     \
+    if (length == (LENGTH))            \
+    {                                  \
+        *sum = dotFixed##LENGTH(a, b); \
+        return 1;                      \
+    }
+    FIXED_DOT_LENGTHS(DISPATCH_FIXED_DOT)
+#undef DISPATCH_FIXED_DOT
+    return 0;
+}
+
+#endif
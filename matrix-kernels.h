@@ -0,0 +1,149 @@
+#ifndef MATRIX_KERNELS_H
+#define MATRIX_KERNELS_H
+
+#include <string.h>
+#include "matrix-fixed.h"
+// Local kernels which multiply a block of rows of matrix1 by the whole of matrix2.
+// a is rows x inner, b is inner x columns and c is rows x columns, all in row-major order.
+// They compute the same product and only differ in the order in which they walk through the memory.
+
+// Order of the loops of the kernel.
+enum KernelType
+{
+    // i-j-k: one inner product per element of c, reading b by columns.
+    KERNEL_NAIVE,
+    // i-k-j: streams through the rows of b and c.
+    KERNEL_STREAMING,
+    // i-k-j over tile x tile blocks of b, which stay in the cache while they are reused by every row of a.
+    KERNEL_BLOCKED,
+    // The kernel unrolled for the shape at compile time (matrix-fixed.h); naive for the other shapes.
+    KERNEL_FIXED
+};
+
+// Kernel and its tile size (only used by KERNEL_BLOCKED).
+struct KernelConfig
+{
+    enum KernelType type;
+    int tile;
+};
+
+// Name of the kernel, used in the reports and the tuning file.
+static inline const char *kernelName(enum KernelType type)
+{
+    switch (type)
+    {
+    case KERNEL_STREAMING:
+        return "streaming";
+    case KERNEL_BLOCKED:
+        return "blocked";
+    case KERNEL_FIXED:
+        return "fixed";
+    default:
+        return "naive";
+    }
+}
+
+// Kernel used for inner x columns matrix2 until one is tuned: the fixed kernel when the shape has one.
+static inline struct KernelConfig defaultKernelConfig(int inner, int columns)
+{
+    struct KernelConfig config = {hasFixedKernel(inner, columns) ? KERNEL_FIXED : KERNEL_NAIVE, 0};
+    return config;
+}
+
+static inline void multiplyRowsNaive(const int *a, int rows, int inner, const int *b, int columns, int *c)
+{
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            int sum = 0;
+            for (int k = 0; k < inner; k++)
+            {
+                sum += a[row * inner + k] * b[k * columns + column];
+            }
+            c[row * columns + column] = sum;
+        }
+    }
+}
+
+static inline void multiplyRowsStreaming(const int *a, int rows, int inner, const int *b, int columns, int *c)
+{
+    memset(c, 0, (size_t)rows * columns * sizeof(int));
+    for (int row = 0; row < rows; row++)
+    {
+        for (int k = 0; k < inner; k++)
+        {
+            int a_element = a[row * inner + k];
+            for (int column = 0; column < columns; column++)
+            {
+                c[row * columns + column] += a_element * b[k * columns + column];
+            }
+        }
+    }
+}
+
+static inline void multiplyRowsBlocked(const int *a, int rows, int inner, const int *b, int columns, int *c, int tile)
+{
+    memset(c, 0, (size_t)rows * columns * sizeof(int));
+    for (int k_start = 0; k_start < inner; k_start += tile)
+    {
+        int k_end = k_start + tile < inner ? k_start + tile : inner;
+        for (int column_start = 0; column_start < columns; column_start += tile)
+        {
+            int column_end = column_start + tile < columns ? column_start + tile : columns;
+            for (int row = 0; row < rows; row++)
+            {
+                for (int k = k_start; k < k_end; k++)
+                {
+                    int a_element = a[row * inner + k];
+                    for (int column = column_start; column < column_end; column++)
+                    {
+                        c[row * columns + column] += a_element * b[k * columns + column];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Multiplies the rows of a by the transposed b (columns x inner), reading both operands of every inner product contiguously.
+static inline void multiplyRowsTransposed(const int *a, int rows, int inner, const int *b_transposed, int columns, int *c)
+{
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            int sum = 0;
+            for (int k = 0; k < inner; k++)
+            {
+                sum += a[row * inner + k] * b_transposed[column * inner + k];
+            }
+            c[row * columns + column] = sum;
+        }
+    }
+}
+
+// Multiplies the rows of a by b with the configured kernel.
+static inline void multiplyRows(struct KernelConfig config, const int *a, int rows, int inner, const int *b, int columns, int *c)
+{
+    switch (config.type)
+    {
+    case KERNEL_STREAMING:
+        multiplyRowsStreaming(a, rows, inner, b, columns, c);
+        break;
+    case KERNEL_BLOCKED:
+        multiplyRowsBlocked(a, rows, inner, b, columns, c, config.tile);
+        break;
+    case KERNEL_FIXED:
+        if (!multiplyRowsFixed(a, rows, inner, b, columns, c))
+        {
+            multiplyRowsNaive(a, rows, inner, b, columns, c);
+        }
+        break;
+    default:
+        multiplyRowsNaive(a, rows, inner, b, columns, c);
+        break;
+    }
+}
+
+#endif
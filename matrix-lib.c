@@ -0,0 +1,339 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <mpi.h>
+#include "matrix-lib.h"
+#include "matrix-kernels.h"
+#include "matrix-autotune.h"
+#if MPI_VERSION < 4 && defined(OPEN_MPI)
+#include <mpi-ext.h>
+#endif
+// The persistent requests are MPI_Scatterv_init, MPI_Bcast_init and MPI_Gatherv_init with MPI 4 (or their MPIX
+// forerunners of the pcollreq extension of Open MPI), and MPI_Send_init / MPI_Recv_init between the root process
+// and every other process otherwise. Defining MATRIX_PLAN_POINT_TO_POINT forces the latter.
+#if MPI_VERSION >= 4 && !defined(MATRIX_PLAN_POINT_TO_POINT)
+#define PLAN_PERSISTENT_COLLECTIVES 1
+#define PLAN_SCATTERV_INIT MPI_Scatterv_init
+#define PLAN_BCAST_INIT MPI_Bcast_init
+#define PLAN_GATHERV_INIT MPI_Gatherv_init
+#elif defined(OMPI_HAVE_MPI_EXT_PCOLLREQ) && !defined(MATRIX_PLAN_POINT_TO_POINT)
+#define PLAN_PERSISTENT_COLLECTIVES 1
+#define PLAN_SCATTERV_INIT MPIX_Scatterv_init
+#define PLAN_BCAST_INIT MPIX_Bcast_init
+#define PLAN_GATHERV_INIT MPIX_Gatherv_init
+#else
+#define PLAN_PERSISTENT_COLLECTIVES 0
+#endif
+
+// Tags of the point-to-point transfers.
+#define PLAN_MATRIX1_TAG 1
+#define PLAN_MATRIX2_TAG 2
+#define PLAN_PRODUCT_TAG 3
+#define PLAN_MATRIX3_TAG 4
+
+struct MatrixPlan
+{
+    MPI_Comm comm;
+    int root;
+    int process_rank;
+    int process_size;
+    int rows;
+    int inner;
+    int columns;
+    // Kernel tuned for the shape, or the default kernel of the shape (the fixed kernel when it has one).
+    struct KernelConfig kernel_config;
+    // Epilogue applied to the product; matrix3 travels in the product buffers when its beta is not zero.
+    struct Epilogue epilogue;
+    // Rows of matrix1 and of the product held by every process.
+    int *block_rows;
+    // Number of elements and offsets of the blocks of matrix1 and of the product, used by the collectives.
+    int *matrix1_counts;
+    int *matrix1_displs;
+    int *product_counts;
+    int *product_displs;
+    // Whole matrices on the root process; the other processes hold the whole matrix2 and their blocks.
+    int *matrix1;
+    int *matrix2;
+    int *product;
+    int *matrix1_block;
+    int *product_block;
+    // Requests which bring the inputs to the process, and which bring the product back.
+    MPI_Request *input_requests;
+    int input_request_count;
+    MPI_Request *product_requests;
+    int product_request_count;
+    // Requests which bring the blocks of matrix3 into the blocks of the product, started only when beta is not zero.
+    MPI_Request *matrix3_requests;
+    int matrix3_request_count;
+};
+
+// Allocates length ints, keeping the allocation valid for zero length.
+static int *allocateInts(size_t length)
+{
+    return malloc((length + 1) * sizeof(int));
+}
+
+// Splits the rows and allocates the buffers of the plan. Returns 0 if some buffer cannot be allocated; the buffers
+// allocated so far are released by destroyMatrixPlan.
+static int allocatePlanBuffers(struct MatrixPlan *plan)
+{
+    // Splits the rows as evenly as possible; the first rows % process_size processes hold one extra row.
+    int process_size = plan->process_size;
+    plan->block_rows = allocateInts(process_size);
+    plan->matrix1_counts = allocateInts(process_size);
+    plan->matrix1_displs = allocateInts(process_size);
+    plan->product_counts = allocateInts(process_size);
+    plan->product_displs = allocateInts(process_size);
+    plan->input_requests = malloc(2 * process_size * sizeof(MPI_Request));
+    plan->product_requests = malloc(process_size * sizeof(MPI_Request));
+    plan->matrix3_requests = malloc(process_size * sizeof(MPI_Request));
+    if (plan->block_rows == NULL || plan->matrix1_counts == NULL || plan->matrix1_displs == NULL || plan->product_counts == NULL ||
+        plan->product_displs == NULL || plan->input_requests == NULL || plan->product_requests == NULL || plan->matrix3_requests == NULL)
+    {
+        return 0;
+    }
+    int first_row = 0;
+    for (int rank = 0; rank < process_size; rank++)
+    {
+        plan->block_rows[rank] = plan->rows / process_size + (rank < plan->rows % process_size ? 1 : 0);
+        plan->matrix1_counts[rank] = plan->block_rows[rank] * plan->inner;
+        plan->matrix1_displs[rank] = first_row * plan->inner;
+        plan->product_counts[rank] = plan->block_rows[rank] * plan->columns;
+        plan->product_displs[rank] = first_row * plan->columns;
+        first_row += plan->block_rows[rank];
+    }
+
+    int local_rows = plan->block_rows[plan->process_rank];
+    plan->matrix2 = allocateInts((size_t)plan->inner * plan->columns);
+    if (plan->process_rank == plan->root)
+    {
+        // The block of the root process is read from and written to the whole matrices in place.
+        plan->matrix1 = allocateInts((size_t)plan->rows * plan->inner);
+        plan->product = allocateInts((size_t)plan->rows * plan->columns);
+        if (plan->matrix1 == NULL || plan->product == NULL)
+        {
+            return 0;
+        }
+        plan->matrix1_block = plan->matrix1 + plan->matrix1_displs[plan->root];
+        plan->product_block = plan->product + plan->product_displs[plan->root];
+    }
+    else
+    {
+        plan->matrix1_block = allocateInts((size_t)local_rows * plan->inner);
+        plan->product_block = allocateInts((size_t)local_rows * plan->columns);
+        if (plan->matrix1_block == NULL || plan->product_block == NULL)
+        {
+            return 0;
+        }
+    }
+    return plan->matrix2 != NULL;
+}
+
+struct MatrixPlan *createMatrixPlan(MPI_Comm comm, int root, int rows, int inner, int columns, enum MatrixElementType type)
+{
+    int process_rank, process_size;
+    MPI_Comm_rank(comm, &process_rank);
+    MPI_Comm_size(comm, &process_size);
+    // The arguments are the same on every process, so every process returns here alike.
+    if (rows <= 0 || inner <= 0 || columns <= 0 || type != MATRIX_INT32 || root < 0 || root >= process_size)
+    {
+        return NULL;
+    }
+
+    // Allocates everything before the first collective, which every process then joins whatever happened.
+    struct MatrixPlan *plan = calloc(1, sizeof(struct MatrixPlan));
+    if (plan != NULL)
+    {
+        plan->comm = MPI_COMM_NULL;
+        plan->process_rank = process_rank;
+        plan->process_size = process_size;
+        plan->root = root;
+        plan->rows = rows;
+        plan->inner = inner;
+        plan->columns = columns;
+        plan->epilogue = identityEpilogue();
+    }
+    int failed = plan == NULL || !allocatePlanBuffers(plan);
+
+    // Every process gives up when any of them could not allocate its buffers.
+    MPI_Allreduce(MPI_IN_PLACE, &failed, 1, MPI_INT, MPI_LOR, comm);
+    if (failed)
+    {
+        destroyMatrixPlan(plan);
+        return NULL;
+    }
+    MPI_Comm_dup(comm, &plan->comm);
+    int is_root = process_rank == root;
+
+    // Looks up the kernel tuned for the shape of the blocks once, on the root process.
+    struct TuningKey tuning_key;
+    createTuningKey(&tuning_key, rows, inner, columns, "int32", process_size);
+    struct KernelConfig kernel_config = defaultKernelConfig(inner, columns);
+    if (is_root)
+    {
+        lookupTuning(&tuning_key, &kernel_config);
+    }
+    int tuning[2] = {kernel_config.type, kernel_config.tile};
+    MPI_Bcast(tuning, 2, MPI_INT, root, plan->comm);
+    plan->kernel_config.type = tuning[0];
+    plan->kernel_config.tile = tuning[1];
+
+#if PLAN_PERSISTENT_COLLECTIVES
+    PLAN_SCATTERV_INIT(plan->matrix1, plan->matrix1_counts, plan->matrix1_displs, MPI_INT,
+                       is_root ? MPI_IN_PLACE : plan->matrix1_block, plan->matrix1_counts[plan->process_rank], MPI_INT,
+                       root, plan->comm, MPI_INFO_NULL, &plan->input_requests[0]);
+    PLAN_BCAST_INIT(plan->matrix2, inner * columns, MPI_INT, root, plan->comm, MPI_INFO_NULL, &plan->input_requests[1]);
+    plan->input_request_count = 2;
+    PLAN_GATHERV_INIT(is_root ? MPI_IN_PLACE : plan->product_block, plan->product_counts[plan->process_rank], MPI_INT,
+                      plan->product, plan->product_counts, plan->product_displs, MPI_INT,
+                      root, plan->comm, MPI_INFO_NULL, &plan->product_requests[0]);
+    plan->product_request_count = 1;
+    PLAN_SCATTERV_INIT(plan->product, plan->product_counts, plan->product_displs, MPI_INT,
+                       is_root ? MPI_IN_PLACE : plan->product_block, plan->product_counts[plan->process_rank], MPI_INT,
+                       root, plan->comm, MPI_INFO_NULL, &plan->matrix3_requests[0]);
+    plan->matrix3_request_count = 1;
+#else
+    if (is_root)
+    {
+        // The root process sends the blocks of matrix1 and the whole matrix2, and receives the blocks of the product.
+        for (int rank = 0; rank < process_size; rank++)
+        {
+            if (rank == root)
+            {
+                continue;
+            }
+            MPI_Send_init(plan->matrix1 + plan->matrix1_displs[rank], plan->matrix1_counts[rank], MPI_INT, rank, PLAN_MATRIX1_TAG,
+                          plan->comm, &plan->input_requests[plan->input_request_count++]);
+            MPI_Send_init(plan->matrix2, inner * columns, MPI_INT, rank, PLAN_MATRIX2_TAG,
+                          plan->comm, &plan->input_requests[plan->input_request_count++]);
+            MPI_Recv_init(plan->product + plan->product_displs[rank], plan->product_counts[rank], MPI_INT, rank, PLAN_PRODUCT_TAG,
+                          plan->comm, &plan->product_requests[plan->product_request_count++]);
+            MPI_Send_init(plan->product + plan->product_displs[rank], plan->product_counts[rank], MPI_INT, rank, PLAN_MATRIX3_TAG,
+                          plan->comm, &plan->matrix3_requests[plan->matrix3_request_count++]);
+        }
+    }
+    else
+    {
+        MPI_Recv_init(plan->matrix1_block, plan->matrix1_counts[plan->process_rank], MPI_INT, root, PLAN_MATRIX1_TAG,
+                      plan->comm, &plan->input_requests[plan->input_request_count++]);
+        MPI_Recv_init(plan->matrix2, inner * columns, MPI_INT, root, PLAN_MATRIX2_TAG,
+                      plan->comm, &plan->input_requests[plan->input_request_count++]);
+        MPI_Send_init(plan->product_block, plan->product_counts[plan->process_rank], MPI_INT, root, PLAN_PRODUCT_TAG,
+                      plan->comm, &plan->product_requests[plan->product_request_count++]);
+        MPI_Recv_init(plan->product_block, plan->product_counts[plan->process_rank], MPI_INT, root, PLAN_MATRIX3_TAG,
+                      plan->comm, &plan->matrix3_requests[plan->matrix3_request_count++]);
+    }
+#endif
+    return plan;
+}
+
+int *matrixPlanMatrix1(struct MatrixPlan *plan)
+{
+    return plan->matrix1;
+}
+
+int *matrixPlanMatrix2(struct MatrixPlan *plan)
+{
+    return plan->process_rank == plan->root ? plan->matrix2 : NULL;
+}
+
+int *matrixPlanProduct(struct MatrixPlan *plan)
+{
+    return plan->product;
+}
+
+void setMatrixPlanEpilogue(struct MatrixPlan *plan, const struct Epilogue *epilogue)
+{
+    plan->epilogue = *epilogue;
+}
+
+// Multiplies the block of matrix1 held by the process, applying the epilogue to the rows of the block.
+static void multiplyPlanBlock(struct MatrixPlan *plan, int local_rows)
+{
+    if (isIdentityEpilogue(&plan->epilogue))
+    {
+        multiplyRows(plan->kernel_config, plan->matrix1_block, local_rows, plan->inner, plan->matrix2, plan->columns, plan->product_block);
+        return;
+    }
+    int first_row = plan->product_displs[plan->process_rank] / plan->columns;
+    multiplyRowsEpilogue(plan->kernel_config, &plan->epilogue, plan->matrix1_block, local_rows, plan->inner, plan->matrix2,
+                         plan->columns, plan->product_block, first_row);
+}
+
+void executeMatrixPlan(struct MatrixPlan *plan)
+{
+    int local_rows = plan->block_rows[plan->process_rank];
+    // matrix3 is only moved when the epilogue reads it.
+    int matrix3_request_count = plan->epilogue.beta != 0 ? plan->matrix3_request_count : 0;
+#if PLAN_PERSISTENT_COLLECTIVES
+    MPI_Startall(plan->input_request_count, plan->input_requests);
+    MPI_Startall(matrix3_request_count, plan->matrix3_requests);
+    MPI_Waitall(plan->input_request_count, plan->input_requests, MPI_STATUSES_IGNORE);
+    MPI_Waitall(matrix3_request_count, plan->matrix3_requests, MPI_STATUSES_IGNORE);
+    multiplyPlanBlock(plan, local_rows);
+    MPI_Startall(plan->product_request_count, plan->product_requests);
+    MPI_Waitall(plan->product_request_count, plan->product_requests, MPI_STATUSES_IGNORE);
+#else
+    if (plan->process_rank == plan->root)
+    {
+        // The blocks of matrix3 leave the product before the blocks of the product arrive in their place, which
+        // can happen while the root process multiplies its own block.
+        MPI_Startall(plan->input_request_count, plan->input_requests);
+        MPI_Startall(matrix3_request_count, plan->matrix3_requests);
+        MPI_Waitall(matrix3_request_count, plan->matrix3_requests, MPI_STATUSES_IGNORE);
+        MPI_Startall(plan->product_request_count, plan->product_requests);
+        multiplyPlanBlock(plan, local_rows);
+        MPI_Waitall(plan->input_request_count, plan->input_requests, MPI_STATUSES_IGNORE);
+        MPI_Waitall(plan->product_request_count, plan->product_requests, MPI_STATUSES_IGNORE);
+        return;
+    }
+    MPI_Startall(plan->input_request_count, plan->input_requests);
+    MPI_Startall(matrix3_request_count, plan->matrix3_requests);
+    MPI_Waitall(plan->input_request_count, plan->input_requests, MPI_STATUSES_IGNORE);
+    MPI_Waitall(matrix3_request_count, plan->matrix3_requests, MPI_STATUSES_IGNORE);
+    multiplyPlanBlock(plan, local_rows);
+    MPI_Startall(plan->product_request_count, plan->product_requests);
+    MPI_Waitall(plan->product_request_count, plan->product_requests, MPI_STATUSES_IGNORE);
+#endif
+}
+
+void destroyMatrixPlan(struct MatrixPlan *plan)
+{
+    if (plan == NULL)
+    {
+        return;
+    }
+    for (int index = 0; index < plan->input_request_count; index++)
+    {
+        MPI_Request_free(&plan->input_requests[index]);
+    }
+    for (int index = 0; index < plan->product_request_count; index++)
+    {
+        MPI_Request_free(&plan->product_requests[index]);
+    }
+    for (int index = 0; index < plan->matrix3_request_count; index++)
+    {
+        MPI_Request_free(&plan->matrix3_requests[index]);
+    }
+    if (plan->process_rank != plan->root)
+    {
+        free(plan->matrix1_block);
+        free(plan->product_block);
+    }
+    free(plan->matrix1);
+    free(plan->matrix2);
+    free(plan->product);
+    free(plan->block_rows);
+    free(plan->matrix1_counts);
+    free(plan->matrix1_displs);
+    free(plan->product_counts);
+    free(plan->product_displs);
+    free(plan->input_requests);
+    free(plan->product_requests);
+    free(plan->matrix3_requests);
+    if (plan->comm != MPI_COMM_NULL)
+    {
+        MPI_Comm_free(&plan->comm);
+    }
+    free(plan);
+}
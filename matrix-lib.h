@@ -0,0 +1,51 @@
+#ifndef MATRIX_LIB_H
+#define MATRIX_LIB_H
+
+#include <mpi.h>
+#include "matrix-epilogue.h"
+// Distributed matrix multiplication as a library.
+// A plan is created once for a communicator, a shape and an element type: it splits matrix1 in blocks of rows
+// across the processes, allocates every buffer and sets up the persistent requests which move the blocks.
+// Every execution then only starts those requests and multiplies, so repeated multiplications of the same shape
+// pay the setup cost once.
+//
+// Usage (every process of the communicator):
+//     struct MatrixPlan *plan = createMatrixPlan(MPI_COMM_WORLD, 0, ROWS, INNER, COLUMNS, MATRIX_INT32);
+//     for each multiplication:
+//         on the root process, fill matrixPlanMatrix1(plan) and matrixPlanMatrix2(plan);
+//         executeMatrixPlan(plan);
+//         on the root process, read matrixPlanProduct(plan);
+//     destroyMatrixPlan(plan);
+// setMatrixPlanEpilogue(plan, &epilogue) makes the executions compute function(alpha * matrix1 x matrix2 +
+// beta * matrix3 + biases) (matrix-epilogue.h); with beta != 0, the root process fills matrixPlanProduct(plan)
+// with matrix3 before every execution, which then replaces it with the product.
+
+// Element types of the matrices.
+enum MatrixElementType
+{
+    MATRIX_INT32
+};
+
+// Plan of the multiplication of a rows x inner matrix1 by an inner x columns matrix2.
+struct MatrixPlan;
+
+// Creates the plan on every process of comm; the root process owns the whole matrices. Collective over comm.
+// Returns NULL on every process if the shape, the element type or the root is not valid, or if some process cannot
+// allocate its buffers.
+struct MatrixPlan *createMatrixPlan(MPI_Comm comm, int root, int rows, int inner, int columns, enum MatrixElementType type);
+// The rows x inner matrix1 of the root process, filled before every execution. NULL on the other processes.
+int *matrixPlanMatrix1(struct MatrixPlan *plan);
+// The inner x columns matrix2 of the root process, filled before every execution. NULL on the other processes.
+int *matrixPlanMatrix2(struct MatrixPlan *plan);
+// The rows x columns product of the root process, valid after every execution. With an epilogue whose beta is not
+// zero, it also holds the matrix3 of the next execution, filled before it. NULL on the other processes.
+int *matrixPlanProduct(struct MatrixPlan *plan);
+// Sets the epilogue of the next executions; the identity epilogue by default. Every process of the communicator
+// sets the same epilogue, with the rows and columns long biases of the whole product, which are not copied.
+void setMatrixPlanEpilogue(struct MatrixPlan *plan, const struct Epilogue *epilogue);
+// Multiplies matrix1 by matrix2 into the product. Collective over the communicator of the plan.
+void executeMatrixPlan(struct MatrixPlan *plan);
+// Releases the buffers and the persistent requests of the plan.
+void destroyMatrixPlan(struct MatrixPlan *plan);
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef MATRIX_PACK_H
+#define MATRIX_PACK_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <mpi.h>
+// Narrow-width packing of the input matrices for the transfers between the processes.
+// The elements are carried over the wire in the narrowest integer type which holds their value range
+// and are widened back to int on receipt, so the products are still accumulated in int.
+
+// Element types which can carry the matrix over the wire.
+enum PackType
+{
+    PACK_INT8,
+    PACK_UINT8,
+    PACK_INT16,
+    PACK_UINT16,
+    PACK_INT32
+};
+
+// Returns the narrowest type which holds every value in [min, max].
+static inline enum PackType packTypeForRange(int min, int max)
+{
+    if (min >= 0 && max <= UINT8_MAX)
+    {
+        return min >= INT8_MIN && max <= INT8_MAX ? PACK_INT8 : PACK_UINT8;
+    }
+    if (min >= INT8_MIN && max <= INT8_MAX)
+    {
+        return PACK_INT8;
+    }
+    if (min >= INT16_MIN && max <= INT16_MAX)
+    {
+        return PACK_INT16;
+    }
+    if (min >= 0 && max <= UINT16_MAX)
+    {
+        return PACK_UINT16;
+    }
+    return PACK_INT32;
+}
+
+// Scans the matrix for its value range and returns the narrowest type which holds it.
+static inline enum PackType detectPackType(const int *matrix, int length)
+{
+    if (length == 0)
+    {
+        return PACK_INT8;
+    }
+    int min = matrix[0], max = matrix[0];
+    for (int index = 1; index < length; index++)
+    {
+        if (matrix[index] < min)
+        {
+            min = matrix[index];
+        }
+        if (matrix[index] > max)
+        {
+            max = matrix[index];
+        }
+    }
+    return packTypeForRange(min, max);
+}
+
+// Returns 1 if every element of the matrix is carried by the type without loss.
+static inline int packTypeHolds(const int *matrix, int length, enum PackType type)
+{
+    int min, max;
+    switch (type)
+    {
+    case PACK_INT8:
+        min = INT8_MIN, max = INT8_MAX;
+        break;
+    case PACK_UINT8:
+        min = 0, max = UINT8_MAX;
+        break;
+    case PACK_INT16:
+        min = INT16_MIN, max = INT16_MAX;
+        break;
+    case PACK_UINT16:
+        min = 0, max = UINT16_MAX;
+        break;
+    default:
+        return 1;
+    }
+    for (int index = 0; index < length; index++)
+    {
+        if (matrix[index] < min || matrix[index] > max)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Parses a declared value range in the form of MIN:MAX. Returns 0 if the range is malformed.
+static inline int parsePackRange(const char *range, int *min, int *max)
+{
+    char *end;
+    long parsed_min = strtol(range, &end, 10);
+    if (end == range || *end != ':')
+    {
+        return 0;
+    }
+    const char *max_start = end + 1;
+    long parsed_max = strtol(max_start, &end, 10);
+    if (end == max_start || *end != '\0' || parsed_min > parsed_max || parsed_min < INT_MIN || parsed_max > INT_MAX)
+    {
+        return 0;
+    }
+    *min = (int)parsed_min;
+    *max = (int)parsed_max;
+    return 1;
+}
+
+// Number of bytes used by one packed element.
+static inline size_t packTypeSize(enum PackType type)
+{
+    switch (type)
+    {
+    case PACK_INT8:
+    case PACK_UINT8:
+        return 1;
+    case PACK_INT16:
+    case PACK_UINT16:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+// MPI datatype of one packed element.
+static inline MPI_Datatype packDatatype(enum PackType type)
+{
+    switch (type)
+    {
+    case PACK_INT8:
+        return MPI_INT8_T;
+    case PACK_UINT8:
+        return MPI_UINT8_T;
+    case PACK_INT16:
+        return MPI_INT16_T;
+    case PACK_UINT16:
+        return MPI_UINT16_T;
+    default:
+        return MPI_INT;
+    }
+}
+
+// Name of the packed type, used in the reports.
+static inline const char *packTypeName(enum PackType type)
+{
+    switch (type)
+    {
+    case PACK_INT8:
+        return "int8";
+    case PACK_UINT8:
+        return "uint8";
+    case PACK_INT16:
+        return "int16";
+    case PACK_UINT16:
+        return "uint16";
+    default:
+        return "int32";
+    }
+}
+
+// Allocates a buffer which holds length packed elements.
+static inline void *allocatePacked(int length, enum PackType type)
+{
+    void *packed;
+    // One extra byte keeps the allocation valid for zero length.
+    if ((packed = malloc((size_t)length * packTypeSize(type) + 1)) == NULL)
+    {
+        printf("Packed matrix cannot be created!");
+        exit(1);
+    }
+    return packed;
+}
+
+// Narrows length elements of the matrix into the packed buffer.
+static inline void packMatrix(const int *matrix, int length, enum PackType type, void *packed)
+{
+    switch (type)
+    {
+    case PACK_INT8:
+        for (int index = 0; index < length; index++)
+            ((int8_t *)packed)[index] = (int8_t)matrix[index];
+        break;
+    case PACK_UINT8:
+        for (int index = 0; index < length; index++)
+            ((uint8_t *)packed)[index] = (uint8_t)matrix[index];
+        break;
+    case PACK_INT16:
+        for (int index = 0; index < length; index++)
+            ((int16_t *)packed)[index] = (int16_t)matrix[index];
+        break;
+    case PACK_UINT16:
+        for (int index = 0; index < length; index++)
+            ((uint16_t *)packed)[index] = (uint16_t)matrix[index];
+        break;
+    default:
+        memcpy(packed, matrix, (size_t)length * sizeof(int));
+        break;
+    }
+}
+
+// Narrows the rows x columns matrix into the packed buffer as its columns x rows transpose.
+static inline void packTransposedMatrix(const int *matrix, int rows, int columns, enum PackType type, void *packed)
+{
+    int *column_elements;
+    if ((column_elements = malloc((rows + 1) * sizeof(int))) == NULL)
+    {
+        printf("Packed column cannot be created!");
+        exit(1);
+    }
+    for (int column = 0; column < columns; column++)
+    {
+        for (int row = 0; row < rows; row++)
+        {
+            column_elements[row] = matrix[(size_t)row * columns + column];
+        }
+        packMatrix(column_elements, rows, type, (char *)packed + (size_t)column * rows * packTypeSize(type));
+    }
+    free(column_elements);
+}
+
+// Widens length packed elements back into the matrix.
+static inline void unpackMatrix(const void *packed, int length, enum PackType type, int *matrix)
+{
+    switch (type)
+    {
+    case PACK_INT8:
+        for (int index = 0; index < length; index++)
+            matrix[index] = ((const int8_t *)packed)[index];
+        break;
+    case PACK_UINT8:
+        for (int index = 0; index < length; index++)
+            matrix[index] = ((const uint8_t *)packed)[index];
+        break;
+    case PACK_INT16:
+        for (int index = 0; index < length; index++)
+            matrix[index] = ((const int16_t *)packed)[index];
+        break;
+    case PACK_UINT16:
+        for (int index = 0; index < length; index++)
+            matrix[index] = ((const uint16_t *)packed)[index];
+        break;
+    default:
+        memcpy(matrix, packed, (size_t)length * sizeof(int));
+        break;
+    }
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <mpi.h>
+#include <time.h>
+#include <string.h>
+#include "matrix-lib.h"
+// Multiplies REPETITIONS pairs of matrices of the same shape through one plan of the library (matrix-lib.h),
+// so the buffers and the persistent requests are set up once for all the multiplications.
+
+// Root process.
+const int ROOT_PROCESS = 0;
+
+// Generates the matrix of provided size.
+void generateMatrix(int *matrix, int rows, int columns);
+// Returns the number of elements of the product which differ from the product of a single process, with the epilogue
+// applied with the previous product matrix3.
+int countMismatches(const int *matrix1, int rows1, int columns1, const int *matrix2, int columns2, const int *product,
+                    const struct Epilogue *epilogue, const int *matrix3);
+// Prints the dashed lines.
+void printDashedLine(int times);
+
+int main(argc, argv) int argc;
+char *argv[];
+{
+    if (argc < 4)
+    {
+        fprintf(stderr, "Usage: please enter the dimension of the matrix and the repetitions(ROWS<space>COLUMNS<space>REPETITIONS<return>)\n");
+        exit(1);
+    }
+    const int ROWS = atoi(argv[1]);
+    const int COLUMNS = atoi(argv[2]);
+    const int REPETITIONS = atoi(argv[3]);
+
+    // Epilogue of the plan, as in matrix-async.c (--alpha=N, --beta=N, --bias=row|column|both, --function=relu|abs|clamp8).
+    struct Epilogue epilogue = identityEpilogue();
+    int row_bias_enabled = 0, column_bias_enabled = 0;
+    for (int arg_index = 4; arg_index < argc; arg_index++)
+    {
+        if (!parseEpilogueOption(argv[arg_index], &epilogue, &row_bias_enabled, &column_bias_enabled))
+        {
+            fprintf(stderr, "Usage: unknown option %s (supported: " EPILOGUE_OPTIONS_USAGE ")\n", argv[arg_index]);
+            exit(1);
+        }
+    }
+
+    int process_rank;
+
+    if (MPI_Init(&argc, &argv) != MPI_SUCCESS)
+    {
+        perror("Error initializing MPI!");
+        exit(1);
+    }
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank); /* get current process id */
+
+    // As in matrix-async.c, matrix1 is ROWS x COLUMNS and matrix2 is COLUMNS x ROWS.
+    double setup_time = MPI_Wtime();
+    struct MatrixPlan *plan = createMatrixPlan(MPI_COMM_WORLD, ROOT_PROCESS, ROWS, COLUMNS, ROWS, MATRIX_INT32);
+    if (plan == NULL)
+    {
+        fprintf(stderr, "Plan cannot be created!\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    setup_time = MPI_Wtime() - setup_time;
+
+    srand(time(NULL));
+
+    // The biases of the ROWS x ROWS product are generated on the root process and given to every process.
+    int row_bias[ROWS], column_bias[ROWS];
+    if (process_rank == ROOT_PROCESS)
+    {
+        generateEpilogueBiases(row_bias, column_bias, ROWS, row_bias_enabled, column_bias_enabled);
+    }
+    MPI_Bcast(row_bias, ROWS, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+    MPI_Bcast(column_bias, ROWS, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+    epilogue.row_bias = row_bias_enabled ? row_bias : NULL;
+    epilogue.column_bias = column_bias_enabled ? column_bias : NULL;
+    setMatrixPlanEpilogue(plan, &epilogue);
+
+    // Copy of the matrix3 of every multiplication, which the product replaces, for the check.
+    int *matrix3 = NULL;
+    if (process_rank == ROOT_PROCESS && epilogue.beta != 0 && (matrix3 = malloc(ROWS * ROWS * sizeof(int))) == NULL)
+    {
+        printf("Accumulated matrix cannot be created!");
+        exit(1);
+    }
+
+    double execution_time = 0;
+    int mismatches = 0;
+    for (int repetition = 0; repetition < REPETITIONS; repetition++)
+    {
+        if (process_rank == ROOT_PROCESS)
+        {
+            generateMatrix(matrixPlanMatrix1(plan), ROWS, COLUMNS);
+            generateMatrix(matrixPlanMatrix2(plan), COLUMNS, ROWS);
+            if (matrix3 != NULL)
+            {
+                generateMatrix(matrixPlanProduct(plan), ROWS, ROWS);
+                memcpy(matrix3, matrixPlanProduct(plan), ROWS * ROWS * sizeof(int));
+            }
+        }
+
+        double starting_time = MPI_Wtime();
+        executeMatrixPlan(plan);
+        execution_time += MPI_Wtime() - starting_time;
+
+        if (process_rank == ROOT_PROCESS)
+        {
+            mismatches += countMismatches(matrixPlanMatrix1(plan), ROWS, COLUMNS, matrixPlanMatrix2(plan), ROWS, matrixPlanProduct(plan),
+                                          &epilogue, matrix3);
+        }
+    }
+
+    if (process_rank == ROOT_PROCESS)
+    {
+        printDashedLine(2);
+        printf("Setup took %f", setup_time);
+        printDashedLine(2);
+        printf("%d multiplications took %f (%f each)", REPETITIONS, execution_time, REPETITIONS > 0 ? execution_time / REPETITIONS : 0);
+        printDashedLine(2);
+        printf("Mismatching elements: %d", mismatches);
+        printDashedLine(2);
+    }
+
+    free(matrix3);
+    destroyMatrixPlan(plan);
+    MPI_Finalize();
+    return mismatches != 0;
+}
+
+int countMismatches(const int *matrix1, int rows1, int columns1, const int *matrix2, int columns2, const int *product,
+                    const struct Epilogue *epilogue, const int *matrix3)
+{
+    int mismatches = 0;
+    for (int i = 0; i < rows1; i++)
+    {
+        for (int j = 0; j < columns2; j++)
+        {
+            int expected = 0;
+            for (int k = 0; k < columns1; k++)
+            {
+                expected += matrix1[i * columns1 + k] * matrix2[k * columns2 + j];
+            }
+            expected = applyEpilogue(epilogue, expected, matrix3 != NULL ? matrix3[i * columns2 + j] : 0, i, j);
+            if (product[i * columns2 + j] != expected)
+            {
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+void generateMatrix(int *matrix, int rows, int columns)
+{
+    for (int index = 0; index < rows * columns; index++)
+    {
+        matrix[index] = rand() % 100;
+    }
+}
+
+void printDashedLine(int times)
+{
+    int times_done = times;
+    printf("\n");
+    while (times_done > 0)
+    {
+        printf("-------------------------------\n");
+        times_done--;
+    }
+}
@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <mpi.h>
+#include <time.h>
+#include <string.h>
+#include <limits.h>
+#include "matrix-resident.h"
+// Raises the square matrix A to the power K by repeated squaring.
+// A^K = A^(b0 * 1) * A^(b1 * 2) * A^(b2 * 4) ..., where bi are the bits of K, so about log2(K) squarings and
+// multiplications are needed. A and the intermediates stay distributed in blocks of rows across the processes
+// (matrix-resident.h) between the multiplications; only the final result is gathered at the root process.
+
+// Root process.
+const int ROOT_PROCESS = 0;
+
+// Generates the adjacency matrix of a random graph of provided size.
+void generateMatrix(long long *matrix, int rows, int columns);
+// Returns the block of the size x size identity matrix held by the process.
+long long *identityResident(int size, MPI_Comm comm);
+// Prints the dashed lines.
+void printDashedLine(int times);
+
+int main(argc, argv) int argc;
+char *argv[];
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: please enter the dimension of the matrix and the power(SIZE<space>POWER<return>)\n");
+        exit(1);
+    }
+    const int SIZE = atoi(argv[1]);
+    const int POWER = atoi(argv[2]);
+    if (SIZE <= 0 || POWER < 0)
+    {
+        fprintf(stderr, "Usage: the dimension must be positive and the power must not be negative\n");
+        exit(1);
+    }
+    // An element of A^k counts the walks of length k, at most SIZE^(k - 1) for a 0/1 matrix, and every power
+    // computed by the squarings is at most A^POWER; all of them must fit a long long.
+    long long largest_walks = 1;
+    for (int power = 1; power < POWER; power++)
+    {
+        if (largest_walks > LLONG_MAX / SIZE)
+        {
+            fprintf(stderr, "Usage: the walks of a %d x %d matrix to the power %d may not fit 64 bits, please enter a smaller size or power\n", SIZE, SIZE, POWER);
+            exit(1);
+        }
+        largest_walks *= SIZE;
+    }
+
+    int process_rank, process_size;
+
+    if (MPI_Init(&argc, &argv) != MPI_SUCCESS)
+    {
+        perror("Error initializing MPI!");
+        exit(1);
+    }
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank); /* get current process id */
+    MPI_Comm_size(MPI_COMM_WORLD, &process_size); /* get number of processes */
+
+    // Will be allocated memory only by the root process
+    long long *matrix = NULL;
+    // To store the starting time.
+    double starting_time = 0;
+
+    if (process_rank == ROOT_PROCESS)
+    {
+        if ((matrix = malloc((size_t)SIZE * SIZE * sizeof(long long))) == NULL)
+        {
+            printf("Matrix cannot be created!");
+            exit(1);
+        }
+        generateMatrix(matrix, SIZE, SIZE);
+        printResidentMatrix(matrix, SIZE, SIZE);
+
+        // Notes the starting time.
+        starting_time = MPI_Wtime();
+        printDashedLine(2);
+        printf("Starting time: %f", starting_time);
+        printDashedLine(2);
+    }
+
+    // A^(2^i) for the current bit i of the power.
+    long long *square_block = scatterResident(matrix, SIZE, SIZE, ROOT_PROCESS, MPI_COMM_WORLD);
+    // Product of the squares of the bits seen so far; NULL stands for the identity matrix.
+    long long *result_block = NULL;
+    int multiplications = 0;
+
+    for (int remaining_power = POWER; remaining_power > 0; remaining_power >>= 1)
+    {
+        if (remaining_power & 1)
+        {
+            if (result_block == NULL)
+            {
+                // The identity times the square is the square itself.
+                int local_length = residentRows(SIZE, process_rank, process_size) * SIZE;
+                result_block = allocateResident(SIZE, SIZE, MPI_COMM_WORLD);
+                memcpy(result_block, square_block, local_length * sizeof(long long));
+            }
+            else
+            {
+                long long *next_block = multiplyResident(result_block, SIZE, SIZE, square_block, SIZE, MPI_COMM_WORLD);
+                free(result_block);
+                result_block = next_block;
+                multiplications++;
+            }
+        }
+        // The last square is not needed.
+        if (remaining_power > 1)
+        {
+            long long *next_block = multiplyResident(square_block, SIZE, SIZE, square_block, SIZE, MPI_COMM_WORLD);
+            free(square_block);
+            square_block = next_block;
+            multiplications++;
+        }
+    }
+    if (result_block == NULL)
+    {
+        result_block = identityResident(SIZE, MPI_COMM_WORLD);
+    }
+
+    long long *resultant_matrix = NULL;
+    if (process_rank == ROOT_PROCESS)
+    {
+        if ((resultant_matrix = malloc((size_t)SIZE * SIZE * sizeof(long long))) == NULL)
+        {
+            printf("Resultant matrix cannot be created!");
+            exit(1);
+        }
+    }
+    // Gathers only the final result at the root process.
+    gatherResident(result_block, SIZE, SIZE, resultant_matrix, ROOT_PROCESS, MPI_COMM_WORLD);
+
+    if (process_rank == ROOT_PROCESS)
+    {
+        // Note the ending time.
+        double ending_time = MPI_Wtime();
+        printf("Multiplications: %d\n", multiplications);
+        printf("Product Matrix:\n");
+        printResidentMatrix(resultant_matrix, SIZE, SIZE);
+
+        // Expected final matrix, multiplied POWER - 1 times.
+        long long *expected_matrix, *next_matrix;
+        if ((expected_matrix = malloc((size_t)SIZE * SIZE * sizeof(long long))) == NULL ||
+            (next_matrix = malloc((size_t)SIZE * SIZE * sizeof(long long))) == NULL)
+        {
+            printf("Expected matrix cannot be created!");
+            exit(1);
+        }
+        for (int index = 0; index < SIZE * SIZE; index++)
+        {
+            expected_matrix[index] = POWER == 0 ? (index / SIZE == index % SIZE) : matrix[index];
+        }
+        for (int power = 1; power < POWER; power++)
+        {
+            multiplyLocal(expected_matrix, SIZE, SIZE, matrix, SIZE, next_matrix);
+            long long *temp = expected_matrix;
+            expected_matrix = next_matrix;
+            next_matrix = temp;
+        }
+        printf("\n\nExpected Matrix:\n");
+        printResidentMatrix(expected_matrix, SIZE, SIZE);
+        free(expected_matrix);
+        free(next_matrix);
+
+        printDashedLine(2);
+        printf("Ending time: %f", ending_time);
+        printDashedLine(2);
+
+        // Time taken.
+        double calc_time = ending_time - starting_time;
+        printDashedLine(2);
+        printf("Took %f", calc_time);
+        printDashedLine(2);
+
+        free(matrix);
+        free(resultant_matrix);
+    }
+
+    free(square_block);
+    free(result_block);
+
+    MPI_Finalize();
+    return 0;
+}
+
+long long *identityResident(int size, MPI_Comm comm)
+{
+    int process_rank, process_size;
+    MPI_Comm_rank(comm, &process_rank);
+    MPI_Comm_size(comm, &process_size);
+
+    // The first row of the block held by the process.
+    int first_row = 0;
+    for (int rank = 0; rank < process_rank; rank++)
+    {
+        first_row += residentRows(size, rank, process_size);
+    }
+    int local_rows = residentRows(size, process_rank, process_size);
+    long long *block = allocateResident(size, size, comm);
+    memset(block, 0, (size_t)local_rows * size * sizeof(long long));
+    for (int row = 0; row < local_rows; row++)
+    {
+        block[row * size + first_row + row] = 1;
+    }
+    return block;
+}
+
+void generateMatrix(long long *matrix, int rows, int columns)
+{
+    srand(time(NULL));
+
+    // Each edge exists with the probability of one half, so A^K counts the walks of length K.
+    for (int index = 0; index < rows * columns; index++)
+    {
+        matrix[index] = rand() % 2;
+    }
+}
+
+void printDashedLine(int times)
+{
+    int times_done = times;
+    printf("\n");
+    while (times_done > 0)
+    {
+        printf("-------------------------------\n");
+        times_done--;
+    }
+}
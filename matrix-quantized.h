@@ -0,0 +1,254 @@
+#ifndef MATRIX_QUANTIZED_H
+#define MATRIX_QUANTIZED_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define QUANTIZED_X86 1
+#endif
+// Low-precision kernels: 8-bit or 16-bit inputs, 32-bit accumulation.
+// The inner products use the dot-product instructions of AVX512-VNNI (512-bit) or AVX-VNNI (256-bit) when the CPU
+// has them, chosen at run time, and a portable loop otherwise. Every path computes the same int32 result.
+//
+// a holds rows x inner elements and b_transposed holds columns x inner elements (the rows of the transposed
+// matrix2), so every inner product reads two contiguous rows; c is rows x columns.
+//
+// 8-bit: a is uint8 and b is int8. A signed int8 a is stored with 128 added (a_offset = 128), which the kernel
+// subtracts again through the sums of the rows of b_transposed. The partial sums of the VNNI instructions stay below
+// 255 * 128 * inner, so the result is exact for inner <= 65793, whatever the values.
+// 16-bit: a and b are int16. The result is exact when inner * max|a| * max|b| < 2^31; the inputs of
+// generateMatrix (0..99) are exact up to inner = 219000.
+
+// Largest inner dimension for which every 8-bit product is exact.
+#define QUANTIZED8_MAX_INNER 65793
+
+// Instruction sets which can run the kernels.
+enum QuantizedIsa
+{
+    QUANTIZED_PORTABLE,
+    QUANTIZED_AVX_VNNI,
+    QUANTIZED_AVX512_VNNI
+};
+
+// Name of the instruction set, used in the reports and by MATRIX_QUANTIZED_ISA.
+static inline const char *quantizedIsaName(enum QuantizedIsa isa)
+{
+    switch (isa)
+    {
+    case QUANTIZED_AVX512_VNNI:
+        return "avx512-vnni";
+    case QUANTIZED_AVX_VNNI:
+        return "avx-vnni";
+    default:
+        return "portable";
+    }
+}
+
+// Returns the widest instruction set of the CPU, capped by MATRIX_QUANTIZED_ISA when it names a narrower one.
+static inline enum QuantizedIsa detectQuantizedIsa(void)
+{
+    enum QuantizedIsa isa = QUANTIZED_PORTABLE;
+#ifdef QUANTIZED_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw"))
+    {
+        isa = QUANTIZED_AVX512_VNNI;
+    }
+    else if (__builtin_cpu_supports("avxvnni"))
+    {
+        isa = QUANTIZED_AVX_VNNI;
+    }
+#endif
+    const char *requested = getenv("MATRIX_QUANTIZED_ISA");
+    for (enum QuantizedIsa candidate = QUANTIZED_PORTABLE; requested != NULL && candidate < isa; candidate++)
+    {
+        if (strcmp(requested, quantizedIsaName(candidate)) == 0)
+        {
+            isa = candidate;
+        }
+    }
+    return isa;
+}
+
+// Sums the elements of every row of the columns x inner b, to take the offset of a back out.
+static inline void sumQuantizedRows(const int8_t *b_transposed, int inner, int columns, int *sums)
+{
+    for (int column = 0; column < columns; column++)
+    {
+        int sum = 0;
+        for (int k = 0; k < inner; k++)
+        {
+            sum += b_transposed[column * inner + k];
+        }
+        sums[column] = sum;
+    }
+}
+
+#ifdef QUANTIZED_X86
+__attribute__((target("avx512f,avx512bw,avx512vnni"))) static inline int dotQuantized8Avx512(const uint8_t *a, const int8_t *b, int inner)
+{
+    __m512i sum = _mm512_setzero_si512();
+    int k = 0;
+    for (; k + 64 <= inner; k += 64)
+    {
+        sum = _mm512_dpbusd_epi32(sum, _mm512_loadu_si512(a + k), _mm512_loadu_si512(b + k));
+    }
+    if (k < inner)
+    {
+        __mmask64 mask = (1ULL << (inner - k)) - 1;
+        sum = _mm512_dpbusd_epi32(sum, _mm512_maskz_loadu_epi8(mask, a + k), _mm512_maskz_loadu_epi8(mask, b + k));
+    }
+    return _mm512_reduce_add_epi32(sum);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni"))) static inline int dotQuantized16Avx512(const int16_t *a, const int16_t *b, int inner)
+{
+    __m512i sum = _mm512_setzero_si512();
+    int k = 0;
+    for (; k + 32 <= inner; k += 32)
+    {
+        sum = _mm512_dpwssd_epi32(sum, _mm512_loadu_si512(a + k), _mm512_loadu_si512(b + k));
+    }
+    if (k < inner)
+    {
+        __mmask32 mask = (__mmask32)((1U << (inner - k)) - 1);
+        sum = _mm512_dpwssd_epi32(sum, _mm512_maskz_loadu_epi16(mask, a + k), _mm512_maskz_loadu_epi16(mask, b + k));
+    }
+    return _mm512_reduce_add_epi32(sum);
+}
+
+// Adds the eight lanes of the 256-bit sum.
+__attribute__((target("avx2"))) static inline int reduceQuantized256(__m256i sum)
+{
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+}
+
+__attribute__((target("avx2,avxvnni"))) static inline int dotQuantized8AvxVnni(const uint8_t *a, const int8_t *b, int inner)
+{
+    __m256i sum = _mm256_setzero_si256();
+    int k = 0;
+    for (; k + 32 <= inner; k += 32)
+    {
+        sum = _mm256_dpbusd_avx_epi32(sum, _mm256_loadu_si256((const __m256i *)(a + k)), _mm256_loadu_si256((const __m256i *)(b + k)));
+    }
+    int result = reduceQuantized256(sum);
+    for (; k < inner; k++)
+    {
+        result += a[k] * b[k];
+    }
+    return result;
+}
+
+__attribute__((target("avx2,avxvnni"))) static inline int dotQuantized16AvxVnni(const int16_t *a, const int16_t *b, int inner)
+{
+    __m256i sum = _mm256_setzero_si256();
+    int k = 0;
+    for (; k + 16 <= inner; k += 16)
+    {
+        sum = _mm256_dpwssd_avx_epi32(sum, _mm256_loadu_si256((const __m256i *)(a + k)), _mm256_loadu_si256((const __m256i *)(b + k)));
+    }
+    int result = reduceQuantized256(sum);
+    for (; k < inner; k++)
+    {
+        result += a[k] * b[k];
+    }
+    return result;
+}
+#endif
+
+static inline int dotQuantized8(const uint8_t *a, const int8_t *b, int inner)
+{
+    int sum = 0;
+    for (int k = 0; k < inner; k++)
+    {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+static inline int dotQuantized16(const int16_t *a, const int16_t *b, int inner)
+{
+    int sum = 0;
+    for (int k = 0; k < inner; k++)
+    {
+        sum += a[k] * b[k];
+    }
+    return sum;
+}
+
+// Multiplies the uint8 a, holding the values plus a_offset, by the int8 b_transposed into c.
+static inline void multiplyQuantized8(enum QuantizedIsa isa, const uint8_t *a, int a_offset, int rows, int inner,
+                                      const int8_t *b_transposed, int columns, int *c)
+{
+    int *sums = NULL;
+    if (a_offset != 0)
+    {
+        if ((sums = malloc((columns + 1) * sizeof(int))) == NULL)
+        {
+            printf("Sums of the quantized matrix cannot be created!");
+            exit(1);
+        }
+        sumQuantizedRows(b_transposed, inner, columns, sums);
+    }
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            const uint8_t *a_row = a + (size_t)row * inner;
+            const int8_t *b_row = b_transposed + (size_t)column * inner;
+            int sum;
+            switch (isa)
+            {
+#ifdef QUANTIZED_X86
+            case QUANTIZED_AVX512_VNNI:
+                sum = dotQuantized8Avx512(a_row, b_row, inner);
+                break;
+            case QUANTIZED_AVX_VNNI:
+                sum = dotQuantized8AvxVnni(a_row, b_row, inner);
+                break;
+#endif
+            default:
+                sum = dotQuantized8(a_row, b_row, inner);
+                break;
+            }
+            c[row * columns + column] = a_offset != 0 ? sum - a_offset * sums[column] : sum;
+        }
+    }
+    free(sums);
+}
+
+// Multiplies the int16 a by the int16 b_transposed into c.
+static inline void multiplyQuantized16(enum QuantizedIsa isa, const int16_t *a, int rows, int inner,
+                                       const int16_t *b_transposed, int columns, int *c)
+{
+    for (int row = 0; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            const int16_t *a_row = a + (size_t)row * inner;
+            const int16_t *b_row = b_transposed + (size_t)column * inner;
+            switch (isa)
+            {
+#ifdef QUANTIZED_X86
+            case QUANTIZED_AVX512_VNNI:
+                c[row * columns + column] = dotQuantized16Avx512(a_row, b_row, inner);
+                break;
+            case QUANTIZED_AVX_VNNI:
+                c[row * columns + column] = dotQuantized16AvxVnni(a_row, b_row, inner);
+                break;
+#endif
+            default:
+                c[row * columns + column] = dotQuantized16(a_row, b_row, inner);
+                break;
+            }
+        }
+    }
+}
+
+#endif
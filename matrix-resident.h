@@ -0,0 +1,148 @@
+#ifndef MATRIX_RESIDENT_H
+#define MATRIX_RESIDENT_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <mpi.h>
+// Matrices which stay distributed across the processes between multiplications.
+// Every matrix is split in blocks of consecutive rows (row-major order), the first rows % process_size processes
+// holding one extra row. The product X * Y keeps the row blocks of X, so a sequence of multiplications only
+// replicates the right operand of each step and never gathers the intermediates at the root process.
+// The elements are long long so the products of several multiplications do not overflow as quickly as int.
+
+// Number of rows of the rows x columns matrix held by the process.
+static inline int residentRows(int rows, int process_rank, int process_size)
+{
+    return rows / process_size + (process_rank < rows % process_size ? 1 : 0);
+}
+
+// Number of elements held by every process and the offsets of their blocks in the whole matrix.
+static inline void residentCounts(int rows, int columns, int process_size, int *counts, int *displs)
+{
+    int offset = 0;
+    for (int rank = 0; rank < process_size; rank++)
+    {
+        counts[rank] = residentRows(rows, rank, process_size) * columns;
+        displs[rank] = offset;
+        offset += counts[rank];
+    }
+}
+
+// Allocates the block of the rows x columns matrix held by the process.
+static inline long long *allocateResident(int rows, int columns, MPI_Comm comm)
+{
+    int process_rank, process_size;
+    MPI_Comm_rank(comm, &process_rank);
+    MPI_Comm_size(comm, &process_size);
+
+    long long *block;
+    // One extra element keeps the allocation valid for the processes without rows.
+    if ((block = malloc(((size_t)residentRows(rows, process_rank, process_size) * columns + 1) * sizeof(long long))) == NULL)
+    {
+        printf("Resident matrix cannot be created!");
+        exit(1);
+    }
+    return block;
+}
+
+// Scatters the rows x columns matrix of the root process and returns the block of the process.
+static inline long long *scatterResident(const long long *matrix, int rows, int columns, int root, MPI_Comm comm)
+{
+    int process_size;
+    MPI_Comm_size(comm, &process_size);
+    int counts[process_size], displs[process_size];
+    residentCounts(rows, columns, process_size, counts, displs);
+
+    int process_rank;
+    MPI_Comm_rank(comm, &process_rank);
+    long long *block = allocateResident(rows, columns, comm);
+    MPI_Scatterv(matrix, counts, displs, MPI_LONG_LONG, block, counts[process_rank], MPI_LONG_LONG, root, comm);
+    return block;
+}
+
+// Gathers the blocks of the rows x columns matrix into the matrix of the root process.
+static inline void gatherResident(const long long *block, int rows, int columns, long long *matrix, int root, MPI_Comm comm)
+{
+    int process_size;
+    MPI_Comm_size(comm, &process_size);
+    int counts[process_size], displs[process_size];
+    residentCounts(rows, columns, process_size, counts, displs);
+
+    int process_rank;
+    MPI_Comm_rank(comm, &process_rank);
+    MPI_Gatherv(block, counts[process_rank], MPI_LONG_LONG, matrix, counts, displs, MPI_LONG_LONG, root, comm);
+}
+
+// Multiplies the distributed x_rows x inner matrix X by the distributed inner x columns matrix Y
+// and returns the block of the x_rows x columns product held by the process.
+static inline long long *multiplyResident(const long long *x_block, int x_rows, int inner,
+                                          const long long *y_block, int columns, MPI_Comm comm)
+{
+    int process_rank, process_size;
+    MPI_Comm_rank(comm, &process_rank);
+    MPI_Comm_size(comm, &process_size);
+
+    // Only the right operand is replicated on every process.
+    int counts[process_size], displs[process_size];
+    residentCounts(inner, columns, process_size, counts, displs);
+    long long *y;
+    if ((y = malloc(((size_t)inner * columns + 1) * sizeof(long long))) == NULL)
+    {
+        printf("Right operand cannot be created!");
+        exit(1);
+    }
+    MPI_Allgatherv(y_block, counts[process_rank], MPI_LONG_LONG, y, counts, displs, MPI_LONG_LONG, comm);
+
+    int local_rows = residentRows(x_rows, process_rank, process_size);
+    long long *product_block = allocateResident(x_rows, columns, comm);
+    memset(product_block, 0, (size_t)local_rows * columns * sizeof(long long));
+    // The i-k-j order streams through the rows of Y and of the product.
+    for (int row = 0; row < local_rows; row++)
+    {
+        for (int k = 0; k < inner; k++)
+        {
+            long long x = x_block[row * inner + k];
+            for (int column = 0; column < columns; column++)
+            {
+                product_block[row * columns + column] += x * y[k * columns + column];
+            }
+        }
+    }
+    free(y);
+    return product_block;
+}
+
+// Multiplies the rows1 x columns1 matrix1 by the columns1 x columns2 matrix2 on a single process.
+static inline void multiplyLocal(const long long *matrix1, int rows1, int columns1, const long long *matrix2, int columns2, long long *product)
+{
+    for (int i = 0; i < rows1; i++)
+    {
+        for (int j = 0; j < columns2; j++)
+        {
+            long long sum = 0;
+            for (int k = 0; k < columns1; k++)
+            {
+                sum += matrix1[i * columns1 + k] * matrix2[k * columns2 + j];
+            }
+            product[i * columns2 + j] = sum;
+        }
+    }
+}
+
+// Prints the rows x columns matrix.
+static inline void printResidentMatrix(const long long *matrix, int rows, int columns)
+{
+    printf("\n");
+    for (int index = 0; index < rows * columns; index++)
+    {
+        if (index != 0 && (index % columns) == 0)
+        {
+            printf("\n");
+        }
+        printf("%lld\t", matrix[index]);
+    }
+    printf("\n");
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef MATRIX_SHARED_H
+#define MATRIX_SHARED_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <mpi.h>
+// Node-local shared memory of the drivers.
+// The processes which share the memory of a node are grouped in a node communicator, led by the process with the
+// lowest rank, and the leaders of the nodes in a leader communicator. A matrix which every process reads is then
+// allocated once per node by the node leader, moved between the nodes only through the leader communicator, and
+// read in place by the other processes of the node.
+//
+// Usage:
+//     MPI_Comm node_comm, leader_comm;
+//     splitNodeComms(MPI_COMM_WORLD, &node_comm, &leader_comm);
+//     int *matrix = allocateNodeSharedMatrix(length, node_comm, &window);
+//     node leaders: fill the matrix, e.g. MPI_Bcast over leader_comm;
+//     MPI_Win_fence(0, window); ... read the matrix ...
+//     MPI_Win_free(&window);
+//     freeNodeComms(&node_comm, &leader_comm);
+
+// Splits comm into the node communicator of the calling process and the leader communicator, which is MPI_COMM_NULL
+// on the processes which do not lead their node. The process with the lowest rank of comm leads its node, so rank 0
+// of comm is always a leader. Returns the rank of the calling process in its node. Collective over comm.
+static inline int splitNodeComms(MPI_Comm comm, MPI_Comm *node_comm, MPI_Comm *leader_comm)
+{
+    int process_rank, node_rank;
+    MPI_Comm_rank(comm, &process_rank);
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, process_rank, MPI_INFO_NULL, node_comm);
+    MPI_Comm_rank(*node_comm, &node_rank);
+    MPI_Comm_split(comm, node_rank == 0 ? 0 : MPI_UNDEFINED, process_rank, leader_comm);
+    return node_rank;
+}
+
+// Releases the communicators of splitNodeComms.
+static inline void freeNodeComms(MPI_Comm *node_comm, MPI_Comm *leader_comm)
+{
+    if (*leader_comm != MPI_COMM_NULL)
+    {
+        MPI_Comm_free(leader_comm);
+    }
+    MPI_Comm_free(node_comm);
+}
+
+// Allocates length elements of element_size bytes once per node in a shared memory window and returns the node
+// leader's copy. Opens the epoch in which the node leader fills the buffer; a fence makes it visible to the node.
+static inline void *allocateNodeSharedBuffer(int length, int element_size, MPI_Comm node_comm, MPI_Win *window)
+{
+    int node_rank;
+    MPI_Comm_rank(node_comm, &node_rank);
+
+    // Only the node leader contributes memory to the window; the other processes attach with zero bytes.
+    MPI_Aint window_size = node_rank == 0 ? (MPI_Aint)length * element_size : 0;
+    void *buffer;
+    if (MPI_Win_allocate_shared(window_size, element_size, MPI_INFO_NULL, node_comm, &buffer, window) != MPI_SUCCESS)
+    {
+        printf("Shared matrix cannot be created!");
+        exit(1);
+    }
+
+    // Every process of the node points to the segment of the node leader.
+    MPI_Aint leader_size;
+    int leader_disp_unit;
+    MPI_Win_shared_query(*window, 0, &leader_size, &leader_disp_unit, &buffer);
+
+    MPI_Win_fence(MPI_MODE_NOPRECEDE, *window);
+    return buffer;
+}
+
+// Allocates the int matrix once per node in a shared memory window and returns the node leader's copy.
+static inline int *allocateNodeSharedMatrix(int length, MPI_Comm node_comm, MPI_Win *window)
+{
+    return allocateNodeSharedBuffer(length, sizeof(int), node_comm, window);
+}
+
+#endif
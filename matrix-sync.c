@@ -3,6 +3,11 @@
 #include <mpi.h>
 #include <time.h>
 #include <limits.h>
+#include <string.h>
+#include "matrix-pack.h"
+#include "matrix-transpose.h"
+#include "matrix-datatypes.h"
+#include "matrix-fixed.h"
 
 // The number of rows for matrix1 and the number of columns for matrix2.
 const int ROWS = 64;
@@ -19,16 +24,34 @@ void printMatrix(int rows, int columns, int matrix[rows][columns]);
 void multiplyMatrix(int rows1, int columns1, int matrix1[rows1][columns1],
                     int rows2, int columns2, int matrix2[rows2][columns2],
                     int mul[rows1][columns2]);
-// Stores the row from matrix to matrix_part.
-void splitRow(int rows, int columns, int split_row, int matrix[rows][columns], int matrix_part[rows]);
-// Stores the column of matrix to inverse_row_matrix.
-void inverseColumnToRow(int rows, int columns, int inv_column, int matrix[rows][columns], int inverse_row_matrix[rows]);
 // Prints the dashed lines.
 void printDashedLine(int times);
 
 int main(argc, argv) int argc;
 char *argv[];
 {
+    // Transposes matrix2 once (--transpose-b) so the columns sent to the processes are read from contiguous memory;
+    // they are sent as strided columns straight from matrix2 otherwise.
+    int transpose_matrix2 = 0;
+    // Carries the elements as int32 (--int32), so the tasks are sent straight from the matrices without packed copies.
+    int wide_transfers = 0;
+    for (int arg_index = 1; arg_index < argc; arg_index++)
+    {
+        if (strcmp(argv[arg_index], "--transpose-b") == 0)
+        {
+            transpose_matrix2 = 1;
+        }
+        else if (strcmp(argv[arg_index], "--int32") == 0)
+        {
+            wide_transfers = 1;
+        }
+        else
+        {
+            fprintf(stderr, "Usage: unknown option %s (supported: --transpose-b, --int32)\n", argv[arg_index]);
+            exit(1);
+        }
+    }
+
     int process_rank, process_size;
 
     MPI_Init(&argc, &argv);                       /* starts MPI */
@@ -46,6 +69,57 @@ char *argv[];
         printMatrix(ROWS, COLUMNS, matrix1);
         printMatrix(COLUMNS, ROWS, matrix2);
 
+        // Selects the narrowest type which carries the elements of each matrix over the wire.
+        int pack_types[2] = {PACK_INT32, PACK_INT32};
+        if (!wide_transfers)
+        {
+            pack_types[0] = detectPackType(&matrix1[0][0], ROWS * COLUMNS);
+            pack_types[1] = detectPackType(&matrix2[0][0], COLUMNS * ROWS);
+        }
+        MPI_Bcast(pack_types, 2, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+        enum PackType matrix1_type = pack_types[0], matrix2_type = pack_types[1];
+        printf("\nTransfer types: %s x %s\n", packTypeName(matrix1_type), packTypeName(matrix2_type));
+
+        // Every task is sent straight from the matrices: from matrix1 and matrix2 themselves when they are carried
+        // as int32, and from copies packed once in the narrow types otherwise.
+        const int *matrix2_source = &matrix2[0][0];
+        const void *matrix1_data = &matrix1[0][0];
+        const void *matrix2_data = matrix2_source;
+        void *packed_matrix1 = NULL, *packed_matrix2 = NULL;
+        int *matrix2_transposed = NULL;
+
+        // The row j of the transposed matrix2 is the column j of matrix2.
+        if (transpose_matrix2)
+        {
+            if ((matrix2_transposed = malloc(ROWS * COLUMNS * sizeof(int))) == NULL)
+            {
+                printf("Transposed matrix cannot be created!");
+                exit(1);
+            }
+            transposeMatrix(&matrix2[0][0], COLUMNS, ROWS, matrix2_transposed);
+            matrix2_source = matrix2_transposed;
+            matrix2_data = matrix2_source;
+        }
+        if (matrix1_type != PACK_INT32)
+        {
+            packed_matrix1 = allocatePacked(ROWS * COLUMNS, matrix1_type);
+            packMatrix(&matrix1[0][0], ROWS * COLUMNS, matrix1_type, packed_matrix1);
+            matrix1_data = packed_matrix1;
+        }
+        if (matrix2_type != PACK_INT32)
+        {
+            packed_matrix2 = allocatePacked(COLUMNS * ROWS, matrix2_type);
+            packMatrix(matrix2_source, COLUMNS * ROWS, matrix2_type, packed_matrix2);
+            matrix2_data = packed_matrix2;
+        }
+
+        // A row of matrix1, and a column of matrix2 which is a row of the transposed matrix2 or a strided column otherwise.
+        MPI_Datatype matrix1_row_type = createRowType(COLUMNS, packDatatype(matrix1_type));
+        MPI_Datatype matrix2_column_type = transpose_matrix2 ? createRowType(COLUMNS, packDatatype(matrix2_type))
+                                                             : createColumnType(COLUMNS, ROWS, packDatatype(matrix2_type));
+        size_t matrix1_element_size = packTypeSize(matrix1_type);
+        size_t matrix2_element_size = packTypeSize(matrix2_type);
+
         float starting_time = MPI_Wtime();
         printDashedLine(2);
         printf("Starting time: %f", starting_time);
@@ -54,8 +128,7 @@ char *argv[];
         int current_task = ROOT_PROCESS;
         for (int i = 0; i < ROWS; i++)
         {
-            int matrix1_part[COLUMNS];
-            inverseColumnToRow(ROWS, COLUMNS, i, matrix1, matrix1_part);
+            const char *matrix1_row = (const char *)matrix1_data + (size_t)i * COLUMNS * matrix1_element_size;
             for (int j = 0; j < ROWS; j++)
             {
                 // Select the process in a round-robin fashion.
@@ -67,13 +140,12 @@ char *argv[];
 
                 int taskId = current_task % process_size;
 
-                int matrix2_part[COLUMNS];
-                splitRow(COLUMNS, ROWS, j, matrix2, matrix2_part);
+                const char *matrix2_column = (const char *)matrix2_data + (size_t)j * (transpose_matrix2 ? COLUMNS : 1) * matrix2_element_size;
 
                 MPI_Send(&COLUMNS, 1, MPI_INT, taskId, 0, MPI_COMM_WORLD);
 
-                MPI_Send(&matrix1_part, COLUMNS, MPI_INT, taskId, 0, MPI_COMM_WORLD);
-                MPI_Send(&matrix2_part, COLUMNS, MPI_INT, taskId, 0, MPI_COMM_WORLD);
+                MPI_Send(matrix1_row, 1, matrix1_row_type, taskId, 0, MPI_COMM_WORLD);
+                MPI_Send(matrix2_column, 1, matrix2_column_type, taskId, 0, MPI_COMM_WORLD);
 
                 int recv_data;
                 MPI_Recv(&recv_data, 1, MPI_INT, taskId, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
@@ -96,6 +168,12 @@ char *argv[];
         // Note the ending time.
         float ending_time = MPI_Wtime();
 
+        MPI_Type_free(&matrix1_row_type);
+        MPI_Type_free(&matrix2_column_type);
+        free(packed_matrix1);
+        free(packed_matrix2);
+        free(matrix2_transposed);
+
         // Print the final product matrix.
         printMatrix(ROWS, ROWS, mul);
         
@@ -118,6 +196,16 @@ char *argv[];
     MPI_Status status;
     if (process_rank != ROOT_PROCESS)
     {
+        // Types of the elements of matrix1 and matrix2 on the wire, selected by the root process.
+        int pack_types[2];
+        MPI_Bcast(pack_types, 2, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+        enum PackType matrix1_type = pack_types[0], matrix2_type = pack_types[1];
+
+        // Buffers for the parts, grown when the root process sends longer parts.
+        int capacity = 0;
+        int *matrix1_part = NULL, *matrix2_part = NULL;
+        void *packed_matrix1_part = NULL, *packed_matrix2_part = NULL;
+
         while (1)
         {
             int total_rows;
@@ -128,42 +216,50 @@ char *argv[];
                 // Process will termiate.
                 break;
             }
-            int matrix1_part[total_rows];
-            int matrix2_part[total_rows];
+            if (total_rows > capacity)
+            {
+                free(matrix1_part);
+                free(matrix2_part);
+                free(packed_matrix1_part);
+                free(packed_matrix2_part);
+                if ((matrix1_part = malloc(total_rows * sizeof(int))) == NULL || (matrix2_part = malloc(total_rows * sizeof(int))) == NULL)
+                {
+                    printf("Receiving buffers cannot be created!");
+                    exit(1);
+                }
+                packed_matrix1_part = allocatePacked(total_rows, matrix1_type);
+                packed_matrix2_part = allocatePacked(total_rows, matrix2_type);
+                capacity = total_rows;
+            }
 
-            MPI_Recv(&matrix1_part, total_rows, MPI_INT, ROOT_PROCESS, 0, MPI_COMM_WORLD, &status);
-            MPI_Recv(&matrix2_part, total_rows, MPI_INT, ROOT_PROCESS, 0, MPI_COMM_WORLD, &status);
+            // Receives the parts in their narrow types and widens them for the multiplication.
+            MPI_Recv(packed_matrix1_part, total_rows, packDatatype(matrix1_type), ROOT_PROCESS, 0, MPI_COMM_WORLD, &status);
+            MPI_Recv(packed_matrix2_part, total_rows, packDatatype(matrix2_type), ROOT_PROCESS, 0, MPI_COMM_WORLD, &status);
+            unpackMatrix(packed_matrix1_part, total_rows, matrix1_type, matrix1_part);
+            unpackMatrix(packed_matrix2_part, total_rows, matrix2_type, matrix2_part);
 
+            // The parts are COLUMNS long, so the inner product is normally unrolled for that length (matrix-fixed.h).
             int product_matrix = 0;
-            for (int row_index = 0; row_index < total_rows; row_index++)
+            if (!dotFixed(matrix1_part, matrix2_part, total_rows, &product_matrix))
             {
-                product_matrix += matrix1_part[row_index] * matrix2_part[row_index];
+                for (int row_index = 0; row_index < total_rows; row_index++)
+                {
+                    product_matrix += matrix1_part[row_index] * matrix2_part[row_index];
+                }
             }
 
             MPI_Send(&product_matrix, 1, MPI_INT, ROOT_PROCESS, 0, MPI_COMM_WORLD);
         }
+        free(matrix1_part);
+        free(matrix2_part);
+        free(packed_matrix1_part);
+        free(packed_matrix2_part);
     }
 
     MPI_Finalize();
     return 0;
 }
 
-void splitRow(int rows, int columns, int split_row, int matrix[rows][columns], int matrix_part[rows])
-{
-    for (int row_index = 0; row_index < rows; row_index++)
-    {
-        matrix_part[row_index] = matrix[row_index][split_row];
-    }
-}
-
-void inverseColumnToRow(int rows, int columns, int inv_row, int matrix[rows][columns], int inverse_row_matrix[rows])
-{
-    for (int column_index = 0; column_index < columns; column_index++)
-    {
-        inverse_row_matrix[column_index] = matrix[inv_row][column_index];
-    }
-}
-
 void multiplyMatrix(int rows1, int columns1, int matrix1[rows1][columns1],
                     int rows2, int columns2, int matrix2[rows2][columns2],
                     int mul[rows1][columns2])
@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <mpi.h>
+#include <time.h>
+#include "matrix-pack.h"
+#include "matrix-transpose.h"
+#include "matrix-syrk.h"
+#include "matrix-shared.h"
+// Multiplies the ROWS x COLUMNS matrix A by its own transpose, C = A x A^T (SYRK).
+// Only A is distributed: it is broadcast once to every node, in its narrow type, into a node-shared matrix, so
+// there is neither a scatter of matrix1 nor a broadcast of matrix2. C is symmetric, so the processes only compute
+// the blocks of its lower triangle (matrix-syrk.h), split so that every process computes about the same number
+// of inner products, which is half of the inner products of the whole product. The root process gathers the
+// blocks and mirrors them into the upper triangle.
+
+// Root process.
+const int ROOT_PROCESS = 0;
+
+// Generates the matrix of provided size.
+void generateMatrix(int *matrix, int rows, int columns);
+// Prints the matrix.
+void printMatrix(int *matrix, int rows, int columns);
+// Multiplies two matrices and prints the product matrix.
+void multiplyMatrix(int *matrix1, int rows1, int columns1, int *matrix2, int rows2, int columns2);
+// Prints the dashed lines.
+void printDashedLine(int times);
+
+int main(argc, argv) int argc;
+char *argv[];
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: please enter the dimension of the matrix(ROWS<space>COLUMNS<return>)\n");
+        exit(1);
+    }
+    const int ROWS = atoi(argv[1]);
+    const int COLUMNS = atoi(argv[2]);
+
+    int process_rank, process_size;
+
+    if (MPI_Init(&argc, &argv) != MPI_SUCCESS)
+    {
+        perror("Error initializing MPI!");
+        exit(1);
+    }
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank); /* get current process id */
+    MPI_Comm_size(MPI_COMM_WORLD, &process_size); /* get number of processes */
+
+    if (ROWS <= 0 || COLUMNS <= 0)
+    {
+        if (process_rank == ROOT_PROCESS)
+        {
+            fprintf(stderr, "Usage: please enter positive dimensions!\n");
+        }
+        MPI_Finalize();
+        exit(1);
+    }
+
+    // To store the starting time.
+    double starting_time = 0;
+
+    int LENGTH_OF_METRIX = ROWS * COLUMNS;
+    // Type of the elements of A on the wire, selected by the root process.
+    int pack_type;
+
+    // Groups the processes which share the memory of a node (matrix-shared.h); only the node leaders take part in
+    // the broadcast of A between the nodes.
+    MPI_Comm node_comm, leader_comm;
+    splitNodeComms(MPI_COMM_WORLD, &node_comm, &leader_comm);
+
+    // Every process reads the rows of A of its blocks, so A is held once per node.
+    MPI_Win matrix_window;
+    int *matrix = allocateNodeSharedMatrix(LENGTH_OF_METRIX, node_comm, &matrix_window);
+
+    if (process_rank == ROOT_PROCESS)
+    {
+        generateMatrix(matrix, ROWS, COLUMNS);
+        printMatrix(matrix, ROWS, COLUMNS);
+
+        pack_type = detectPackType(matrix, LENGTH_OF_METRIX);
+        printf("\nTransfer type: %s\n", packTypeName(pack_type));
+
+        // Notes the starting time.
+        starting_time = MPI_Wtime();
+        printDashedLine(2);
+        printf("Starting time: %f", starting_time);
+        printDashedLine(2);
+    }
+
+    MPI_Bcast(&pack_type, 1, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+
+    // Broadcasts A to the node leaders in its narrow type and widens it into the shared matrix of each node.
+    if (leader_comm != MPI_COMM_NULL)
+    {
+        void *packed_matrix = allocatePacked(LENGTH_OF_METRIX, pack_type);
+        if (process_rank == ROOT_PROCESS)
+        {
+            packMatrix(matrix, LENGTH_OF_METRIX, pack_type, packed_matrix);
+        }
+        MPI_Bcast(packed_matrix, LENGTH_OF_METRIX, packDatatype(pack_type), ROOT_PROCESS, leader_comm);
+        if (process_rank != ROOT_PROCESS)
+        {
+            unpackMatrix(packed_matrix, LENGTH_OF_METRIX, pack_type, matrix);
+        }
+        free(packed_matrix);
+    }
+    // Makes the A written by the node leader visible to the other processes of the node.
+    MPI_Win_fence(0, matrix_window);
+
+    // Blocks of the lower triangle computed by every process, and the elements they take in the gathered buffer.
+    int first_pairs[process_size + 1];
+    int block_counts[process_size], block_displs[process_size];
+    partitionSyrkPairs(ROWS, process_size, first_pairs);
+    int blocks_length = 0;
+    for (int rank = 0; rank < process_size; rank++)
+    {
+        block_displs[rank] = blocks_length;
+        block_counts[rank] = 0;
+        for (int pair = first_pairs[rank]; pair < first_pairs[rank + 1]; pair++)
+        {
+            block_counts[rank] += syrkPairElements(ROWS, pair);
+        }
+        blocks_length += block_counts[rank];
+    }
+
+    // The upper triangles of the diagonal blocks are not computed; they are zeroed so the whole blocks can be sent.
+    int *blocks;
+    if ((blocks = calloc(block_counts[process_rank] + 1, sizeof(int))) == NULL)
+    {
+        printf("Blocks cannot be created!");
+        exit(1);
+    }
+    int *block = blocks;
+    for (int pair = first_pairs[process_rank]; pair < first_pairs[process_rank + 1]; pair++)
+    {
+        multiplySyrkPair(matrix, ROWS, COLUMNS, pair, block);
+        block += syrkPairElements(ROWS, pair);
+    }
+
+    int *gathered_blocks = NULL;
+    if (process_rank == ROOT_PROCESS)
+    {
+        if ((gathered_blocks = malloc(blocks_length * sizeof(int))) == NULL)
+        {
+            printf("Gathered blocks cannot be created!");
+            exit(1);
+        }
+    }
+
+    // Gathers the blocks of every process in the order of the work items.
+    MPI_Gatherv(blocks, block_counts[process_rank], MPI_INT, gathered_blocks, block_counts, block_displs, MPI_INT, ROOT_PROCESS, MPI_COMM_WORLD);
+
+    // Blocks until all the processes call this method on the MPI_COMM_WORLD communicator
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    if (ROOT_PROCESS == process_rank)
+    {
+        int *product_matrix;
+        if ((product_matrix = malloc(ROWS * ROWS * sizeof(int))) == NULL)
+        {
+            printf("Resultant matrix cannot be created!");
+            exit(1);
+        }
+        block = gathered_blocks;
+        for (int pair = 0; pair < syrkPairs(ROWS); pair++)
+        {
+            mirrorSyrkPair(block, ROWS, pair, product_matrix);
+            block += syrkPairElements(ROWS, pair);
+        }
+
+        // Note the ending time.
+        double ending_time = MPI_Wtime();
+        printf("Product Matrix:\n");
+        printMatrix(product_matrix, ROWS, ROWS);
+
+        // Expected final product matrix.
+        int *transposed_matrix;
+        if ((transposed_matrix = malloc(LENGTH_OF_METRIX * sizeof(int))) == NULL)
+        {
+            printf("Transposed matrix cannot be created!");
+            exit(1);
+        }
+        transposeMatrix(matrix, ROWS, COLUMNS, transposed_matrix);
+        printf("\n\nExpected Matrix:\n");
+        multiplyMatrix(matrix, ROWS, COLUMNS, transposed_matrix, COLUMNS, ROWS);
+
+        printDashedLine(2);
+        printf("Ending time: %f", ending_time);
+        printDashedLine(2);
+
+        // Time taken.
+        double calc_time = ending_time - starting_time;
+        printDashedLine(2);
+        printf("Took %f", calc_time);
+        printDashedLine(2);
+        printf("Blocks of %d rows: %d of %d over %d processes", SYRK_BLOCK, syrkPairs(ROWS), syrkBlocks(ROWS) * syrkBlocks(ROWS), process_size);
+        printDashedLine(2);
+
+        free(transposed_matrix);
+        free(product_matrix);
+        free(gathered_blocks);
+    }
+    free(blocks);
+
+    // Releases A along with the node communicators.
+    MPI_Win_free(&matrix_window);
+    freeNodeComms(&node_comm, &leader_comm);
+
+    MPI_Finalize();
+    return 0;
+}
+
+void multiplyMatrix(int *matrix1, int rows1, int columns1, int *matrix2, int rows2, int columns2)
+{
+    int *result_matrix;
+    if ((result_matrix = malloc(rows1 * columns2 * sizeof(int))) == NULL)
+    {
+        printf("Resultant matrix cannot be created!");
+        exit(1);
+    }
+    for (int i = 0; i < rows1; i++)
+    {
+        for (int j = 0; j < columns2; j++)
+        {
+            result_matrix[i * columns2 + j] = 0;
+            for (int k = 0; k < rows2; k++)
+            {
+                result_matrix[i * columns2 + j] += matrix1[i * rows2 + k] * matrix2[k * columns2 + j];
+            }
+        }
+    }
+    printMatrix(result_matrix, rows1, columns2);
+    free(result_matrix);
+}
+
+void generateMatrix(int *matrix, int rows, int columns)
+{
+    srand(time(NULL));
+
+    for (int index = 0; index < rows * columns; index++)
+    {
+        matrix[index] = rand() % 100;
+    }
+}
+
+void printMatrix(int *matrix, int rows, int columns)
+{
+    printf("\n");
+    for (int row = 0; row < rows * columns; row++)
+    {
+        if (row != 0 && (row % columns) == 0)
+        {
+            printf("\n");
+        }
+        printf("%d\t", matrix[row]);
+    }
+    printf("\n");
+}
+
+void printDashedLine(int times)
+{
+    int times_done = times;
+    printf("\n");
+    while (times_done > 0)
+    {
+        printf("-------------------------------\n");
+        times_done--;
+    }
+}
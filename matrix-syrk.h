@@ -0,0 +1,130 @@
+#ifndef MATRIX_SYRK_H
+#define MATRIX_SYRK_H
+
+// Symmetric product C = A x A^T of the rows x inner A.
+// C is symmetric, so only its lower triangle is computed: C is split in SYRK_BLOCK x SYRK_BLOCK blocks and the
+// blocks (block_row, block_column) with block_column <= block_row, numbered row by row, are the work items. Every
+// element of a block is the inner product of two rows of A, so both operands are read contiguously. Diagonal blocks
+// only compute their lower triangle. The upper triangle is filled in by mirroring the blocks into C.
+
+// Rows and columns of a block of C.
+#define SYRK_BLOCK 32
+
+// Number of blocks along a side of C.
+static inline int syrkBlocks(int rows)
+{
+    return (rows + SYRK_BLOCK - 1) / SYRK_BLOCK;
+}
+
+// Number of blocks of the lower triangle of C.
+static inline int syrkPairs(int rows)
+{
+    int blocks = syrkBlocks(rows);
+    return blocks * (blocks + 1) / 2;
+}
+
+// Rows of the block block_row of C (the last one may be shorter).
+static inline int syrkBlockRows(int rows, int block_row)
+{
+    return rows - block_row * SYRK_BLOCK < SYRK_BLOCK ? rows - block_row * SYRK_BLOCK : SYRK_BLOCK;
+}
+
+// Block of C of the work item pair.
+static inline void syrkPair(int pair, int *block_row, int *block_column)
+{
+    int row = 0;
+    while (pair > row)
+    {
+        pair -= row + 1;
+        row++;
+    }
+    *block_row = row;
+    *block_column = pair;
+}
+
+// Elements of the buffer of the block, which holds the whole block even on the diagonal.
+static inline int syrkPairElements(int rows, int pair)
+{
+    int block_row, block_column;
+    syrkPair(pair, &block_row, &block_column);
+    return syrkBlockRows(rows, block_row) * syrkBlockRows(rows, block_column);
+}
+
+// Inner products computed for the block.
+static inline long long syrkPairWork(int rows, int pair)
+{
+    int block_row, block_column;
+    syrkPair(pair, &block_row, &block_column);
+    long long height = syrkBlockRows(rows, block_row);
+    return block_row == block_column ? height * (height + 1) / 2 : height * syrkBlockRows(rows, block_column);
+}
+
+// Splits the work items in process_size contiguous ranges of about the same number of inner products:
+// the process rank computes the pairs first_pairs[rank] up to first_pairs[rank + 1].
+static inline void partitionSyrkPairs(int rows, int process_size, int *first_pairs)
+{
+    int pairs = syrkPairs(rows);
+    long long total = 0;
+    for (int pair = 0; pair < pairs; pair++)
+    {
+        total += syrkPairWork(rows, pair);
+    }
+    long long done = 0;
+    int pair = 0;
+    for (int rank = 0; rank < process_size; rank++)
+    {
+        first_pairs[rank] = pair;
+        // Takes pairs while the work done stays closest to the share of the processes up to this one.
+        long long share = total * (rank + 1) / process_size;
+        while (pair < pairs && done + syrkPairWork(rows, pair) / 2 < share)
+        {
+            done += syrkPairWork(rows, pair);
+            pair++;
+        }
+    }
+    first_pairs[process_size] = pairs;
+}
+
+// Computes the block of the work item pair of C = A x A^T into the row-major block buffer.
+static inline void multiplySyrkPair(const int *a, int rows, int inner, int pair, int *block)
+{
+    int block_row, block_column;
+    syrkPair(pair, &block_row, &block_column);
+    int height = syrkBlockRows(rows, block_row), width = syrkBlockRows(rows, block_column);
+    const int *a_rows = a + (size_t)block_row * SYRK_BLOCK * inner;
+    const int *a_columns = a + (size_t)block_column * SYRK_BLOCK * inner;
+    for (int row = 0; row < height; row++)
+    {
+        // The diagonal blocks stop at the diagonal.
+        int columns = block_row == block_column ? row + 1 : width;
+        for (int column = 0; column < columns; column++)
+        {
+            int sum = 0;
+            for (int k = 0; k < inner; k++)
+            {
+                sum += a_rows[row * inner + k] * a_columns[column * inner + k];
+            }
+            block[row * width + column] = sum;
+        }
+    }
+}
+
+// Writes the block of the work item pair into the rows x rows C and mirrors it into the upper triangle.
+static inline void mirrorSyrkPair(const int *block, int rows, int pair, int *c)
+{
+    int block_row, block_column;
+    syrkPair(pair, &block_row, &block_column);
+    int height = syrkBlockRows(rows, block_row), width = syrkBlockRows(rows, block_column);
+    for (int row = 0; row < height; row++)
+    {
+        int columns = block_row == block_column ? row + 1 : width;
+        for (int column = 0; column < columns; column++)
+        {
+            int c_row = block_row * SYRK_BLOCK + row, c_column = block_column * SYRK_BLOCK + column;
+            c[c_row * rows + c_column] = block[row * width + column];
+            c[c_column * rows + c_row] = block[row * width + column];
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef MATRIX_TRANSPOSE_H
+#define MATRIX_TRANSPOSE_H
+
+#include <stdlib.h>
+#include <stdio.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+// Cache-oblivious transposition of the row-major matrices.
+// The matrix is split in halves along its longer side until a tile fits in the L1 cache, so each level of the
+// memory hierarchy is used well without knowing its size. Transposing matrix2 once lets every inner product
+// read both of its operands from contiguous memory (see row-major-order.txt for the resulting layout).
+
+// Side of the tiles which are transposed directly (32 x 32 ints = 4 KB for each of the source and destination).
+#define TRANSPOSE_TILE 32
+
+// Transposes the rows x columns tile of src (row stride src_stride) into dst (row stride dst_stride).
+static inline void transposeTile(const int *src, int src_stride, int *dst, int dst_stride, int rows, int columns)
+{
+    int row = 0;
+#ifdef __SSE2__
+    // Transposes the 4 x 4 sub-tiles with the SSE2 shuffles.
+    for (; row + 4 <= rows; row += 4)
+    {
+        int column = 0;
+        for (; column + 4 <= columns; column += 4)
+        {
+            const int *s = src + row * src_stride + column;
+            __m128i r0 = _mm_loadu_si128((const __m128i *)(s));
+            __m128i r1 = _mm_loadu_si128((const __m128i *)(s + src_stride));
+            __m128i r2 = _mm_loadu_si128((const __m128i *)(s + 2 * src_stride));
+            __m128i r3 = _mm_loadu_si128((const __m128i *)(s + 3 * src_stride));
+            __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+            __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+            __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+            __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+            int *d = dst + column * dst_stride + row;
+            _mm_storeu_si128((__m128i *)(d), _mm_unpacklo_epi64(t0, t1));
+            _mm_storeu_si128((__m128i *)(d + dst_stride), _mm_unpackhi_epi64(t0, t1));
+            _mm_storeu_si128((__m128i *)(d + 2 * dst_stride), _mm_unpacklo_epi64(t2, t3));
+            _mm_storeu_si128((__m128i *)(d + 3 * dst_stride), _mm_unpackhi_epi64(t2, t3));
+        }
+        // Remaining columns of these four rows.
+        for (; column < columns; column++)
+        {
+            for (int sub_row = row; sub_row < row + 4; sub_row++)
+            {
+                dst[column * dst_stride + sub_row] = src[sub_row * src_stride + column];
+            }
+        }
+    }
+#endif
+    for (; row < rows; row++)
+    {
+        for (int column = 0; column < columns; column++)
+        {
+            dst[column * dst_stride + row] = src[row * src_stride + column];
+        }
+    }
+}
+
+// Recursively halves the longer side of the rows x columns block until it fits in a tile.
+static inline void transposeBlock(const int *src, int src_stride, int *dst, int dst_stride, int rows, int columns)
+{
+    if (rows <= TRANSPOSE_TILE && columns <= TRANSPOSE_TILE)
+    {
+        transposeTile(src, src_stride, dst, dst_stride, rows, columns);
+    }
+    else if (rows >= columns)
+    {
+        int half = rows / 2;
+        transposeBlock(src, src_stride, dst, dst_stride, half, columns);
+        transposeBlock(src + half * src_stride, src_stride, dst + half, dst_stride, rows - half, columns);
+    }
+    else
+    {
+        int half = columns / 2;
+        transposeBlock(src, src_stride, dst, dst_stride, rows, half);
+        transposeBlock(src + half, src_stride, dst + half * dst_stride, dst_stride, rows, columns - half);
+    }
+}
+
+// Transposes the rows x columns matrix into the columns x rows transposed matrix.
+static inline void transposeMatrix(const int *matrix, int rows, int columns, int *transposed)
+{
+    transposeBlock(matrix, columns, transposed, rows, rows, columns);
+}
+
+// Swaps the rows x columns block a with the transpose of the columns x rows block b, both with row stride stride.
+static inline void swapTransposedBlocks(int *a, int *b, int stride, int rows, int columns)
+{
+    if (rows <= TRANSPOSE_TILE && columns <= TRANSPOSE_TILE)
+    {
+        for (int row = 0; row < rows; row++)
+        {
+            for (int column = 0; column < columns; column++)
+            {
+                int temp = a[row * stride + column];
+                a[row * stride + column] = b[column * stride + row];
+                b[column * stride + row] = temp;
+            }
+        }
+    }
+    else if (rows >= columns)
+    {
+        int half = rows / 2;
+        swapTransposedBlocks(a, b, stride, half, columns);
+        swapTransposedBlocks(a + half * stride, b + half, stride, rows - half, columns);
+    }
+    else
+    {
+        int half = columns / 2;
+        swapTransposedBlocks(a, b, stride, rows, half);
+        swapTransposedBlocks(a + half, b + half * stride, stride, rows, columns - half);
+    }
+}
+
+// Transposes the size x size block in place by transposing the diagonal quadrants and swapping the others.
+static inline void transposeSquareBlock(int *matrix, int stride, int size)
+{
+    if (size <= TRANSPOSE_TILE)
+    {
+        for (int row = 0; row < size; row++)
+        {
+            for (int column = row + 1; column < size; column++)
+            {
+                int temp = matrix[row * stride + column];
+                matrix[row * stride + column] = matrix[column * stride + row];
+                matrix[column * stride + row] = temp;
+            }
+        }
+        return;
+    }
+    int half = size / 2;
+    transposeSquareBlock(matrix, stride, half);
+    transposeSquareBlock(matrix + half * stride + half, stride, size - half);
+    swapTransposedBlocks(matrix + half, matrix + half * stride, stride, half, size - half);
+}
+
+// Transposes the rows x columns matrix in place, leaving a columns x rows matrix.
+// Only the square case is cache-oblivious; a non-square matrix is permuted cycle by cycle with random accesses,
+// so transposeMatrix into a second buffer is preferred whenever one is available.
+static inline void transposeMatrixInPlace(int *matrix, int rows, int columns)
+{
+    if (rows == columns)
+    {
+        transposeSquareBlock(matrix, columns, rows);
+        return;
+    }
+
+    // Follows the permutation cycles of the non-square matrix; the element at index moves to
+    // (index % columns) * rows + index / columns.
+    int length = rows * columns;
+    unsigned char *moved;
+    if ((moved = calloc(length + 1, 1)) == NULL)
+    {
+        printf("Transposed matrix cannot be created!");
+        exit(1);
+    }
+    for (int start = 0; start < length; start++)
+    {
+        if (moved[start])
+        {
+            continue;
+        }
+        int index = start;
+        int value = matrix[start];
+        do
+        {
+            int next = (index % columns) * rows + index / columns;
+            int temp = matrix[next];
+            matrix[next] = value;
+            value = temp;
+            moved[next] = 1;
+            index = next;
+        } while (index != start);
+    }
+    free(moved);
+}
+
+#endif
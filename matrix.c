@@ -3,6 +3,8 @@
 #include <mpi.h>
 #include <time.h>
 #include <limits.h>
+#include "matrix-transpose.h"
+#include "matrix-shared.h"
 // We will use the row-major order to store multidimensional arrays in linear storage such as random access memory.
 // This also helps to scatter the elements of the array and process them in more easy way.
 // Reference: https://en.wikipedia.org/wiki/Row-_and_column-major_order
@@ -14,7 +16,7 @@ void generateMatrix(int *matrix, int rows, int columns);
 void printMatrix(int *matrix, int rows, int columns);
 void multiplyMatrix(int *matrix1, int rows1, int columns1, int *matrix2, int rows2, int columns2);
 int multiply(int a, int b);
-int *inverseColumnToRow(int *matrix, int rows, int columns);
+void inverseColumnToRow(int *matrix, int rows, int columns, int *inverse_matrix);
 void printDashedLine(int times);
 void print2DMatrix(int rows, int columns, int matrix[rows][columns]);
 void printPartialMatrix(int *matrix, int size);
@@ -63,14 +65,16 @@ char *argv[];
 
     int *matrix1;
 
-    // As second matrix must be possessed by every process, memory allocation should be done by every process.
-    int *matrix2;
-    if ((matrix2 = malloc(LENGTH_OF_METRIX * sizeof(int))) == NULL)
-    {
-        printf("Second matrix cannot be created!");
-        exit(1);
-    }
-    // int *inverse_matrix2;
+    // Groups the processes which share the memory of a node (matrix-shared.h); the root process always leads its node,
+    // and only the node leaders take part in the broadcast of matrix2 between the nodes.
+    MPI_Comm node_comm, leader_comm;
+    splitNodeComms(MPI_COMM_WORLD, &node_comm, &leader_comm);
+
+    // As second matrix must be possessed by every process, it is allocated once per node by the node leader
+    // and the other processes of the node read it in place.
+    MPI_Win matrix2_window;
+    // The shared matrix holds the inverse of matrix2 (its columns as rows), so the inner products read it contiguously.
+    int *matrix2 = allocateNodeSharedMatrix(LENGTH_OF_METRIX, node_comm, &matrix2_window);
 
     if (process_rank == root_process)
     {
@@ -80,7 +84,15 @@ char *argv[];
             exit(1);
         }
         generateMatrix(matrix1, ROWS, COLUMNS);
-        generateMatrix(matrix2, COLUMNS, ROWS);
+        int *original_matrix2;
+        if ((original_matrix2 = malloc(LENGTH_OF_METRIX * sizeof(int))) == NULL)
+        {
+            printf("Second matrix cannot be created!");
+            exit(1);
+        }
+        generateMatrix(original_matrix2, COLUMNS, ROWS);
+        inverseColumnToRow(original_matrix2, COLUMNS, ROWS, matrix2);
+        free(original_matrix2);
 
         float starting_time = MPI_Wtime();
         printDashedLine(2);
@@ -101,7 +113,12 @@ char *argv[];
     // }
 
     MPI_Scatter(matrix1, send_count, MPI_INT, matrix1_rows, send_count, MPI_INT, root_process, MPI_COMM_WORLD);
-    MPI_Bcast(matrix2, LENGTH_OF_METRIX, MPI_INT, root_process, MPI_COMM_WORLD);
+    if (leader_comm != MPI_COMM_NULL)
+    {
+        MPI_Bcast(matrix2, LENGTH_OF_METRIX, MPI_INT, root_process, leader_comm);
+    }
+    // Makes the matrix2 written by the node leader visible to the other processes of the node.
+    MPI_Win_fence(0, matrix2_window);
 
     // printf("\nmatrix 1\n");
     // printPartialMatrix(matrix1_rows, send_count);
@@ -140,7 +157,7 @@ char *argv[];
             {
                 // printf("%d::: %d -> ++ %d * %d\n", process_rank, product_matrix_index, (column_index + COLUMNS * (product_matrix_row_index)), ((column_index) * (ROWS) + row_index));
                 // printf("%d::: %d += %d * %d\n", process_rank, product_matrix[product_matrix_index], matrix1_rows[column_index + ROWS * (product_matrix_index)], matrix2[(column_index) * (ROWS) + row_index]);
-                product_matrix[product_matrix_index] += matrix1_rows[column_index + COLUMNS * (product_matrix_row_index)] * matrix2[(column_index) * (ROWS) + row_index];
+                product_matrix[product_matrix_index] += matrix1_rows[column_index + COLUMNS * (product_matrix_row_index)] * matrix2[row_index * COLUMNS + column_index];
             }
             // printf("%d::: %d -> %d\n\n", process_rank, product_matrix_index, product_matrix[product_matrix_index]);
         }
@@ -189,6 +206,10 @@ char *argv[];
         printDashedLine(2);
     }
 
+    // Releases the matrix2 of the node along with the node communicators.
+    MPI_Win_free(&matrix2_window);
+    freeNodeComms(&node_comm, &leader_comm);
+
     MPI_Finalize();
     if (root_process == process_rank)
     {
@@ -196,7 +217,6 @@ char *argv[];
         free(matrix1);
         free(resultant_matrix);
     }
-    free(matrix2);
     free(product_matrix);
     return 0;
 }
@@ -206,24 +226,10 @@ int multiply(int a, int b)
     return a * b;
 }
 
-int *inverseColumnToRow(int *matrix, int rows, int columns)
+void inverseColumnToRow(int *matrix, int rows, int columns, int *inverse_matrix)
 {
-    int *matrix_part;
-    if ((matrix_part = malloc(columns * sizeof(int))) == NULL)
-    {
-        printf("Resultant matrix cannot be created!");
-        exit(1);
-    }
-    int new_index = 0;
-    for (int column_index = 0; column_index < columns; column_index++)
-    {
-        for (int row_index = 0; row_index < rows; row_index++)
-        {
-            matrix_part[new_index] = matrix[(column_index + row_index) * columns];
-            new_index++;
-        }
-    }
-    return matrix_part;
+    // The columns of the matrix become the rows of the inverse matrix (see row-major-order.txt).
+    transposeMatrix(matrix, rows, columns, inverse_matrix);
 }
 
 void multiplyMatrix(int *matrix1, int rows1, int columns1, int *matrix2, int rows2, int columns2)
@@ -1,6 +1,18 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <mpi.h>
+// Point-to-point microbenchmark.
+// Bounces messages of 1 byte up to MAX_BYTES (doubling the size each step) between two processes and reports the
+// one-way latency (half of the round trip) and the bandwidth of every size as comma separated values.
+
+// Largest message, in bytes, when not given on the command line (256 MB).
+const long DEFAULT_MAX_BYTES = 256L * 1024 * 1024;
+// Bytes moved for every message size, which sets the number of round trips of the size.
+const long TARGET_BYTES = 512L * 1024 * 1024;
+// Bounds of the number of round trips of every message size.
+const int MIN_ROUND_TRIPS = 5;
+const int MAX_ROUND_TRIPS = 1000;
 
 int main(argc, argv) int argc;
 char *argv[];
@@ -10,8 +22,6 @@ char *argv[];
     MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
-    int PING_PONG_LIMIT = 100;
-    int ping_pong_count = 0;
     int partner_rank = (world_rank + 1) % 2;
 
     // We are assuming 2 processes for this task
@@ -21,26 +31,66 @@ char *argv[];
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
 
-    while (ping_pong_count < PING_PONG_LIMIT)
+    long max_bytes = argc > 1 ? atol(argv[1]) : DEFAULT_MAX_BYTES;
+    if (max_bytes < 1)
+    {
+        fprintf(stderr, "Usage: %s [MAX_BYTES]\n", argv[0]);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    char *message;
+    if ((message = malloc(max_bytes)) == NULL)
     {
-        if (world_rank == ping_pong_count % 2)
+        fprintf(stderr, "Message of %ld bytes cannot be created!\n", max_bytes);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    memset(message, world_rank, max_bytes);
+
+    if (world_rank == 0)
+    {
+        printf("benchmark,bytes,processes,round_trips,latency_us,bandwidth_MBps\n");
+    }
+
+    for (long bytes = 1; bytes <= max_bytes; bytes *= 2)
+    {
+        long round_trips = TARGET_BYTES / bytes;
+        if (round_trips < MIN_ROUND_TRIPS)
         {
-            // Increment the ping pong count before you send it
-            ping_pong_count++;
-            MPI_Send(&ping_pong_count, 1, MPI_INT, partner_rank, 0,
-                     MPI_COMM_WORLD);
-            printf("%d sent and incremented ping_pong_count "
-                   "%d to %d\n",
-                   world_rank, ping_pong_count,
-                   partner_rank);
+            round_trips = MIN_ROUND_TRIPS;
         }
-        else
+        if (round_trips > MAX_ROUND_TRIPS)
+        {
+            round_trips = MAX_ROUND_TRIPS;
+        }
+
+        // The first round trip warms up the connection and is not timed.
+        double starting_time = 0;
+        for (long ping_pong_count = 0; ping_pong_count <= round_trips; ping_pong_count++)
         {
-            MPI_Recv(&ping_pong_count, 1, MPI_INT, partner_rank, 0,
-                     MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-            printf("%d received ping_pong_count %d from %d\n",
-                   world_rank, ping_pong_count, partner_rank);
+            if (ping_pong_count == 1)
+            {
+                starting_time = MPI_Wtime();
+            }
+            if (world_rank == 0)
+            {
+                MPI_Send(message, bytes, MPI_CHAR, partner_rank, 0, MPI_COMM_WORLD);
+                MPI_Recv(message, bytes, MPI_CHAR, partner_rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            }
+            else
+            {
+                MPI_Recv(message, bytes, MPI_CHAR, partner_rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                MPI_Send(message, bytes, MPI_CHAR, partner_rank, 0, MPI_COMM_WORLD);
+            }
+        }
+        double one_way_time = (MPI_Wtime() - starting_time) / (2.0 * round_trips);
+
+        if (world_rank == 0)
+        {
+            printf("ping_pong,%ld,%d,%ld,%.3f,%.3f\n", bytes, world_size, round_trips,
+                   one_way_time * 1e6, bytes / one_way_time / 1e6);
         }
     }
+
+    free(message);
     MPI_Finalize();
 }